@@ -1,4 +1,10 @@
+#ifndef eStopHeader
+#define eStopHeader
+
 #include <sensor_msgs/Joy.h>
+#include <ros/ros.h>
+
+#include <atomic>
 
 class teleController{
 public:	
@@ -22,12 +28,15 @@ public:
 		}
 
 		if(joy->buttons[2] == 1){
-			teleop = !teleop; 
+			teleop = !teleop;
 		}
 			
 	}
+    // The callback runs on the joystick spinner thread, so wait on the flag instead of spinning a core
     void block(){
-        while(state == 1){};
+        while(state && ros::ok()){
+            ros::Duration(0.01).sleep();
+        }
     }
 
 	double getLinear(){
@@ -60,8 +69,10 @@ public:
 
 
 private:
-	double linear, angular;
-	bool state;
-    bool teleop;
+	std::atomic<double> linear, angular;
+	std::atomic<bool> state;
+    std::atomic<bool> teleop;
 };
 
+#endif
+
@@ -1,10 +1,16 @@
 #include "biasedExplore.h"
+#include "candidateBuffer.h"
+#include "contactLayer.h"
+#include "exploreScheduler.h"
+#include "clock.h"
 
 float sweepAngular = Deg2Rad(30.0);
 float sweepReturnAngularTolerance = 1.5;
 int minSweepPoints = 180;
 float stopBeforeWallDistance = 0.4;
 float distanceLimit = 4;
+float partialSweepMaxTurn = 380;    // Degrees, safety stop if the coverage never completes
+float contactPathPenalty = 0.2;     // Score factor for candidates whose straight approach passes a bumper hit
 
 bool isWallSegment(const std::vector<std::array<float, 2>> &points, int startIdx, int endIdx) {
     int N = endIdx - startIdx + 1;
@@ -110,9 +116,9 @@ void findFirstDestination(float posX, float posY, std::vector<std::array<float,
     }
 }
 
-void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
     ROS_INFO("sweep360() called...");
-    ros::spinOnce();
+    spinSensors();
     angular = sweepAngular;
     linear = 0;
     float startingYaw = yaw;
@@ -122,9 +128,15 @@ void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twi
     float endpointY;
     std::array<float, 2> endpoint;
 
+    // A full turn that would overrun the contest clock is cut short
+    double deadline = clockNow() + sweepTurnLimit() / Rad2Deg(sweepAngular);
+
     int lastHeading = std::round(startingYaw) - 1;
     while(sweptPoints.size() < minSweepPoints || std::abs(yaw-startingYaw) > sweepReturnAngularTolerance){
-        ros::spinOnce();
+        spinSensors();
+        if(cancel.requested() || clockNow() > deadline){
+            break;
+        }
 
         // yaw = 0 until rotated bug workaround
         if(startingYaw == 0){
@@ -132,7 +144,7 @@ void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twi
             continue;
         }
 
-        if(std::round(yaw) != lastHeading){
+        if(std::round(yaw) != lastHeading && !std::isnan(distances.frontRay)){
             endpointX = posX + distances.frontRay * std::cos(Deg2Rad(yaw));
             endpointY = posY + distances.frontRay * std::sin(Deg2Rad(yaw));
 
@@ -146,18 +158,73 @@ void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twi
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
         
         
     }
 
     vel.angular.z = (float) 0.0;
     vel.linear.x = (float) 0.0;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
     ROS_INFO("...sweep360() finished.");
 }
 
+void sweepUnobserved(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    ROS_INFO("sweepUnobserved() called...");
+    spinSensors();
+
+    float lastYaw = yaw;
+    float turned = 0;
+    float direction = 0;
+    float ccw, cw;
+    float maxTurn = std::min(partialSweepMaxTurn, sweepTurnLimit());
+
+    // Turn only until every bearing has fresh coverage. Every scan along the way marks its whole
+    // fan as covered (laserCallback), so a full panorama costs about 360 - 57 degrees of rotation
+    // and much less when part of it is already known.
+    while(controlOk() && !cancel.requested()){
+        spinSensors();
+
+        float step = yaw - lastYaw;
+        while(step > 180) step -= 360;
+        while(step < -180) step += 360;
+        turned += step;
+        lastYaw = yaw;
+
+        float halfFov = Rad2Deg(scan.ranges.size() * scan.angleIncrement) / 2;
+        if(!uncoveredTurn(posX, posY, yaw, halfFov, clockNow(), ccw, cw)){
+            break;
+        }
+
+        // Commit to the shorter direction once, so the robot does not dither between the two
+        if(direction == 0){
+            direction = ccw <= cw ? 1 : -1;
+            ROS_INFO("sweepUnobserved() | %.0f degrees left to cover", std::min(ccw, cw));
+        }
+
+        if(std::abs(turned) > maxTurn){
+            ROS_WARN("sweepUnobserved() | coverage incomplete after %.0f degrees", turned);
+            break;
+        }
+
+        angular = direction * sweepAngular;
+        linear = 0;
+        vel.angular.z = angular;
+        vel.linear.x = linear;
+        publishVelocity(vel, vel_pub);
+    }
+
+    angular = 0;
+    linear = 0;
+    vel.angular.z = angular;
+    vel.linear.x = linear;
+    stopVelocity(vel_pub);
+
+    collectCandidates(posX, posY, sweptPoints);
+    ROS_INFO("...sweepUnobserved() finished after %.0f degrees.", std::abs(turned));
+}
+
 void findNextDestination(float posX, float posY, std::vector<std::array<float, 2>> sweptPoints, std::vector<std::array<float, 2>> &visitedPoints, float &nextX, float &nextY){
     int selectedIndex = 0;
     float maxSum = 0;
@@ -205,4 +272,72 @@ void findNextDestination(float posX, float posY, std::vector<std::array<float, 2
 
     ROS_INFO("Distance of %.2f at index %d.", maxSum, selectedIndex);
 
-}
\ No newline at end of file
+}
+
+void findNextDestination(float posX, float posY, const PointGrid &candidateGrid, PointGrid &visitedGrid, float &nextX, float &nextY){
+    // Same scoring as the point-list version, but over one representative per cell: candidates
+    // on a densely sampled wall count once, and a cell visited n times weighs n times its most
+    // recent visit. The cost is bounded by the explored area instead of the sampling density.
+    ScopedMetric probe(METRIC_FIND_DESTINATION);
+    if(gridSize(candidateGrid) == 0){
+        ROS_WARN("No candidates, staying at (%.2f, %.2f).", posX, posY);
+        nextX = posX;
+        nextY = posY;
+        return;
+    }
+
+    size_t selectedIndex = 0;
+    float maxSum = 0;
+    float thisSum;
+
+    float weightedK = 0.1;
+
+    insertPoint(visitedGrid, posX, posY);
+
+    for(size_t i = 0; i < gridSize(candidateGrid); i++){
+        const GridCell &candidate = gridCell(candidateGrid, i);
+        thisSum = 0;
+
+        for(size_t j = 0; j < gridSize(visitedGrid); j++){
+            const GridCell &visited = gridCell(visitedGrid, j);
+            float jCoefficient = visited.count * exp(weightedK * visited.order);
+            thisSum += jCoefficient * (float) pow(distanceBetween(visited.x, visited.y, candidate.x, candidate.y), 0.5);
+        }
+
+        // Something the scan cannot see was hit on the way there before
+        if(!contactLayerEmpty() && contactSegmentClearance(posX, posY, candidate.x, candidate.y) < robotRadius){
+            thisSum *= contactPathPenalty;
+        }
+
+        if(thisSum > maxSum){
+            maxSum = thisSum;
+            selectedIndex = i;
+        }
+    }
+
+    // Get nextX and nextY, apply compensation for robot to stop before the wall
+    nextX = gridCell(candidateGrid, selectedIndex).x;
+    nextY = gridCell(candidateGrid, selectedIndex).y;
+    ROS_INFO("NextX/NextY before: %.2f/%.2f", nextX, nextY);
+
+    float nextDist = distanceBetween(posX, posY, nextX, nextY) - stopBeforeWallDistance;
+    float nextYaw = Rad2Deg(atan2(nextY - posY, nextX - posX));
+
+    nextX = posX + nextDist * std::cos(Deg2Rad(nextYaw));
+    nextY = posY + nextDist * std::sin(Deg2Rad(nextYaw));
+
+    // The pull-back only keeps clear of the wall that was hit; push the target down the
+    // distance field gradient until it is clear of every mapped wall
+    for(int i = 0; i < 3; i++){
+        float clearance = esdfDistance(nextX, nextY);
+        float gx, gy;
+        if(clearance >= stopBeforeWallDistance || !esdfGradient(nextX, nextY, gx, gy)){
+            break;
+        }
+        nextX += gx * (stopBeforeWallDistance - clearance);
+        nextY += gy * (stopBeforeWallDistance - clearance);
+    }
+
+    ROS_INFO("NextX/NextY after: %.2f/%.2f", nextX, nextY);
+    ROS_INFO("Distance of %.2f at cell %zu of %zu (%zu visited cells).", maxSum, selectedIndex, gridSize(candidateGrid), gridSize(visitedGrid));
+}
@@ -3,12 +3,18 @@
 
 
 #include "common.h"
+#include "cancelToken.h"
 #include "movement.h"
 #include "laser.h"
 #include "common.h"
+#include "pointGrid.h"
 
-void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+extern float distanceLimit;         // Candidates further than this (m) are not offered
+
+void sweep360(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+void sweepUnobserved(std::vector<std::array<float, 2>> &sweptPoints, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 void findNextDestination(float posX, float posY, std::vector<std::array<float, 2>> sweptPoints, std::vector<std::array<float, 2>> &visitedPoints, float &nextX, float &nextY);
+void findNextDestination(float posX, float posY, const PointGrid &candidateGrid, PointGrid &visitedGrid, float &nextX, float &nextY);
 bool isWallSegment(const std::vector<std::array<float, 2>> &points, int startIdx, int endIdx);
 std::array<float, 2> findLeftWall(const std::vector<std::array<float, 2>> &sweptPoints);
 void findFirstDestination(float posX, float posY, std::vector<std::array<float, 2>> sweptPoints, 
@@ -1,19 +1,28 @@
-BUMPER.cpp
-
 #include "bumper.h"
+#include "contactLayer.h"
+#include "tfCache.h"
+#include "exploreScheduler.h"
+#include "clock.h"
 
 // Existing global variables for bumper state
 uint8_t bumper[3] = {kobuki_msgs::BumperEvent::RELEASED, kobuki_msgs::BumperEvent::RELEASED, kobuki_msgs::BumperEvent::RELEASED};
 BumpersStruct bumpers;
 
-// Make sure to include these headers
-#include <tf/transform_listener.h> // For transforming poses
-#include <visualization_msgs/Marker.h>
-#include <geometry_msgs/PoseStamped.h>
-#include <tf/transform_datatypes.h>
+int bumperMarkerLimit = 100;    // Marker ids are reused after this many hits
+double bumperStopHold = 0.3;    // s the robot is held stopped after a press unless a recovery takes over
+float recoveryStallDistance = 0.02; // m a recovery advance must gain every recoveryStallTimeout
+double recoveryStallTimeout = 2.0;  // s, an advance the governor holds at zero is cut short after this
 
 void bumperCallback(const kobuki_msgs::BumperEvent::ConstPtr& msg){
     bumper[msg->bumper] = msg->state;
+    if(msg->state == kobuki_msgs::BumperEvent::PRESSED){
+        recordBumperContact(msg->bumper, posX, posY, yaw);
+
+        // Stop at the next control period, before whichever behavior is running gets round to
+        // checking the bumpers; the recovery itself then submits at the same priority
+        geometry_msgs::Twist stop;
+        submitCommand(SOURCE_BUMPER_RECOVERY, stop, bumperStopHold, currentCommandTag());
+    }
     bumpers.leftPressed = bumper[kobuki_msgs::BumperEvent::LEFT];
     bumpers.centerPressed = bumper[kobuki_msgs::BumperEvent::CENTER];
     bumpers.rightPressed = bumper[kobuki_msgs::BumperEvent::RIGHT];
@@ -25,37 +34,42 @@ void bumperCallback(const kobuki_msgs::BumperEvent::ConstPtr& msg){
     if(bumpers.anyPressed){
         // Create a PoseStamped in the "odom" frame using current odometry data.
         geometry_msgs::PoseStamped odom_pose;
-        odom_pose.header.stamp = ros::Time::now();
+        odom_pose.header.stamp.fromNSec(clockNowNs());
         odom_pose.header.frame_id = "odom";  // Use "odom" since posX and posY come from odometry
         odom_pose.pose.position.x = posX;
         odom_pose.pose.position.y = posY;
         odom_pose.pose.position.z = 0.0;
         odom_pose.pose.orientation = tf::createQuaternionMsgFromYaw(Deg2Rad(yaw));
 
-        // Transform the odom_pose to the "map" frame.
-        static tf::TransformListener listener;
-        geometry_msgs::PoseStamped map_pose;
-        try{
-            listener.waitForTransform("map", "odom", ros::Time(0), ros::Duration(1.0));
-            listener.transformPose("map", odom_pose, map_pose);
+        // Transform the odom_pose to the "map" frame with the cached transform; waiting on tf
+        // here would hold up every other callback right after a hit
+        CachedTransform odomToMap = cachedOdomToMap();
+        geometry_msgs::PoseStamped map_pose = odom_pose;
+        map_pose.header.frame_id = "map";
+        if(odomToMap.valid){
+            float c = std::cos(odomToMap.yaw);
+            float s = std::sin(odomToMap.yaw);
+            map_pose.pose.position.x = odomToMap.x + c * posX - s * posY;
+            map_pose.pose.position.y = odomToMap.y + s * posX + c * posY;
+            map_pose.pose.orientation = tf::createQuaternionMsgFromYaw(Deg2Rad(yaw) + odomToMap.yaw);
         }
-        catch(tf::TransformException &ex){
-            ROS_WARN("Transform failed: %s", ex.what());
-            // Fallback: use the odom_pose if the transform fails (but change its frame id)
-            map_pose = odom_pose;
-            map_pose.header.frame_id = "map";
+        else {
+            // Fallback: use the odom_pose until the first transform arrives (but change its frame id)
+            ROS_WARN_THROTTLE(5, "bumperCallback() | No map <- odom transform yet, using odometry.");
         }
 
-        // Publish transformed pose
-        pose_pub.publish(map_pose);
+        // Publish transformed pose (there is no publisher in replay)
+        if(pose_pub){
+            pose_pub.publish(map_pose);
+        }
 
-        // Create and publish a SPHERE marker (yellow, circular, and larger)
+        // Create and queue a SPHERE marker (yellow, circular, and larger)
         static int marker_id = 0;
         visualization_msgs::Marker marker;
-        marker.header.stamp = ros::Time::now();
+        marker.header.stamp = odom_pose.header.stamp;
         marker.header.frame_id = "map";
         marker.ns = "bumper_markers";
-        marker.id = marker_id++;
+        marker.id = marker_id++ % bumperMarkerLimit;
         marker.type = visualization_msgs::Marker::SPHERE;
         marker.action = visualization_msgs::Marker::ADD;
         marker.pose = map_pose.pose;  // Use the transformed pose.
@@ -66,12 +80,14 @@ void bumperCallback(const kobuki_msgs::BumperEvent::ConstPtr& msg){
         marker.color.r = 0.0;
         marker.color.g = 1.0;
         marker.color.b = 0.0;
-        marker_pub.publish(marker);
+        queueMarker(marker);
     }
 }
 
-void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    BehaviorScope behavior(BEHAVIOR_BUMPER_RECOVERY);
     ROS_INFO("handleBumperPressed() called...");
+    resetVelocityProfiler();   // The bumper hit has already stopped the base
     float reverseDistance = 0.18;
     float forwardDistance = reverseDistance / std::cos(Deg2Rad(turnAngle)) * 0.9;
 
@@ -86,8 +102,8 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
     float dy;
     float d = 0;
 
-    while((d-reverseDistance) < exitDistanceThreshold){
-        ros::spinOnce();
+    while((d-reverseDistance) < exitDistanceThreshold && !cancel.requested()){
+        spinSensors();
 
         linear = -0.1;
         angular = 0;
@@ -98,13 +114,22 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
     }
 
 
+    if(cancel.requested()){
+        stopVelocity(vel_pub);
+        return;
+    }
+
     // 2. Turn
     if(turnAngle == 0){ // If center bumper was pressed this is called
-        if(distances.leftRay > distances.rightRay){
+        // Turn towards the side with more room, remembered obstacles included since the fan
+        // cannot see beside the robot
+        float leftRoom = std::min(distances.leftRay, nearestObstacleInArc(20, 120));
+        float rightRoom = std::min(distances.rightRay, nearestObstacleInArc(-120, -20));
+        if(leftRoom > rightRoom){
             turnAngle = 60;
         }
 
@@ -114,10 +139,10 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
 
     }
     ROS_INFO("handleBumperPressed() | Turning...");
-    rotateToHeading(yaw + turnAngle, vel, vel_pub);
+    rotateToHeading(yaw + turnAngle, vel, vel_pub, cancel);
 
     // 3. Drive Forward
-    if(bumpers.anyPressed){
+    if(bumpers.anyPressed || cancel.requested()){
         return;
     }
     ROS_INFO("handleBumperPressed() | Advancing...");
@@ -126,8 +151,10 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
     dx = 0;
     dy = 0;
     d = 0;
-    while((d-forwardDistance) < exitDistanceThreshold){
-        ros::spinOnce();
+    float progressD = 0;
+    double lastProgress = clockNow();
+    while((d-forwardDistance) < exitDistanceThreshold && !cancel.requested()){
+        spinSensors();
 
         linear = 0.1;
         angular = 0;
@@ -136,16 +163,28 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
         dy = posY-y0;
         d = (float) sqrt(pow(dx, 2) + pow(dy, 2));
 
-
+        // The governor stops the advance when the turn left the robot facing something
+        if(d > progressD + recoveryStallDistance){
+            progressD = d;
+            lastProgress = clockNow();
+        }
+        else if(clockNow() - lastProgress > recoveryStallTimeout){
+            ROS_INFO("handleBumperPressed() | Advance blocked after %.2f m, moving on", d);
+            break;
+        }
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
     }
 
     // 4. Turn Back
+    if(cancel.requested()){
+        stopVelocity(vel_pub);
+        return;
+    }
     ROS_INFO("handleBumperPressed() | Correcting yaw...");
-    rotateToHeading(yaw - turnAngle, vel, vel_pub);
+    rotateToHeading(yaw - turnAngle, vel, vel_pub, cancel);
 
 
     ROS_INFO("handleBumperPressed() | END");
@@ -154,7 +193,7 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
 
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
     return;
 
@@ -177,16 +216,18 @@ void handleBumperPressed(float turnAngle, geometry_msgs::Twist &vel, ros::Publis
 // }    
 
 
-void checkBumper(geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+void checkBumper(geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
     if(bumpers.anyPressed){
+        double start = clockNow();
         if(bumper[kobuki_msgs::BumperEvent::LEFT]){
-            handleBumperPressed(-60.0f, vel, vel_pub);
+            handleBumperPressed(-60.0f, vel, vel_pub, cancel);
         }
         else if(bumper[kobuki_msgs::BumperEvent::RIGHT]){
-            handleBumperPressed(60.0f, vel, vel_pub);
+            handleBumperPressed(60.0f, vel, vel_pub, cancel);
         }
         else if(bumper[kobuki_msgs::BumperEvent::CENTER]){
-            handleBumperPressed(0.0f, vel, vel_pub);
+            handleBumperPressed(0.0f, vel, vel_pub, cancel);
         }
+        noteRecovery(clockNow() - start);
     }
 }
@@ -0,0 +1,58 @@
+#include "cancelToken.h"
+#include "commandArbiter.h"
+#include "eventLog.h"
+#include "clock.h"
+
+double cancelStopHold = 1e6;    // s, effectively until cleared
+double contestTimerPoll = 0.05; // s between checks of the contest clock
+
+CancelToken motionCancel;
+
+static std::thread timerThread;
+static std::atomic<bool> timerStopping{false};
+
+void fireCancel(CancelToken &token, CancelReason reason){
+    geometry_msgs::Twist stop;
+    submitCommand(SOURCE_CANCEL_STOP, stop, cancelStopHold, {0, 0, BEHAVIOR_OTHER});
+    uint32_t previous = token.reasons.fetch_or(reason);
+    if(!(previous & reason)){
+        logEvent(EV_CANCEL_FIRED, reason);
+    }
+}
+
+void clearCancel(CancelToken &token, CancelReason reason){
+    uint32_t previous = token.reasons.fetch_and(~(uint32_t) reason);
+    if((previous & ~(uint32_t) reason) == 0){
+        cancelCommand(SOURCE_CANCEL_STOP);
+        // Fired again in between: put the stop back
+        if(token.requested()){
+            geometry_msgs::Twist stop;
+            submitCommand(SOURCE_CANCEL_STOP, stop, cancelStopHold, {0, 0, BEHAVIOR_OTHER});
+        }
+    }
+    if(previous & reason){
+        logEvent(EV_CANCEL_CLEARED, reason);
+    }
+}
+
+void startContestTimer(double seconds){
+    timerStopping = false;
+    uint64_t end = clockLiveNs() + (uint64_t) (seconds * 1e9);
+    timerThread = std::thread([end]{
+        // Polled on the controller clock so the budget runs at the simulator's speed. A background
+        // thread, so the live clock: the control thread sees the timer through motionCancel.
+        while(!timerStopping && ros::ok()){
+            if(clockLiveNs() >= end){
+                ROS_WARN("Contest time is up, stopping.");
+                fireCancel(motionCancel, CANCEL_CONTEST_TIMER);
+                return;
+            }
+            ros::Duration(contestTimerPoll).sleep();
+        }
+    });
+}
+
+void stopContestTimer(){
+    timerStopping = true;
+    if(timerThread.joinable()) timerThread.join();
+}
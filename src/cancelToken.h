@@ -0,0 +1,46 @@
+#ifndef cancelTokenHeader
+#define cancelTokenHeader
+
+#include "common.h"
+#include "replay.h"
+
+#include <atomic>
+
+// Cooperative cancellation for the blocking motion primitives. Every primitive takes a token
+// (motionCancel unless told otherwise) and returns as soon as it is fired, checking once per
+// control iteration. Firing also holds a zero twist at the top priority of the command arbiter,
+// so the robot stops at the next control period whatever the control thread is doing.
+
+enum CancelReason : uint32_t {
+    CANCEL_ESTOP = 1,           // Joystick e-stop, cleared when it is released
+    CANCEL_CONTEST_TIMER = 2    // Contest time is up, never cleared
+};
+
+struct CancelToken{
+    std::atomic<uint32_t> reasons{0};
+
+    bool requested() const { return current() != 0; }
+    bool requested(CancelReason reason) const { return (current() & reason) != 0; }
+
+    // Fired by other threads, so a recorded input; a replay that runs out of log ends the contest
+    uint32_t current() const {
+        uint32_t now = CANCEL_CONTEST_TIMER;
+        if(replayInput(REPLAY_CANCEL, &now, sizeof(now))) return now;
+        now = reasons.load(std::memory_order_relaxed);
+        recordInput(REPLAY_CANCEL, &now, sizeof(now));
+        return now;
+    }
+};
+
+extern CancelToken motionCancel;
+
+void fireCancel(CancelToken &token, CancelReason reason);
+
+void clearCancel(CancelToken &token, CancelReason reason);
+
+// Fires CANCEL_CONTEST_TIMER on motionCancel after the given time, from its own thread
+void startContestTimer(double seconds);
+
+void stopContestTimer();
+
+#endif
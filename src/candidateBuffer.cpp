@@ -0,0 +1,102 @@
+#include "candidateBuffer.h"
+#include "biasedExplore.h"
+
+float candidateCellSize = 0.25;         // One candidate per cell of this size (m)
+float candidateRaySpacing = 1.0;        // Degrees between rays turned into candidates
+double bearingMaxAge = 20.0;            // Seconds a bearing stays covered
+float bearingMaxDisplacement = 1.0;     // Metres the robot may move before a bearing counts as unseen
+
+size_t candidateCapacity = 16384;       // Cells, about 1000 m^2 of walls at the default cell size
+
+CandidateBuffer candidates = {PointGrid(candidateCellSize, candidateCapacity, GRID_LATEST), {}};
+
+static int wrapBearing(int bearingDeg){
+    wrapIntegerIndexAroundRange(bearingDeg, 0, 359);
+    return bearingDeg;
+}
+
+void resetCandidates(){
+    clearPointGrid(candidates.points);
+    for(size_t i = 0; i < candidates.bearings.size(); i++){
+        candidates.bearings[i] = {-1, 0, 0};
+    }
+}
+
+void observeScanCandidates(const ScanStruct &scan, float posX, float posY, float yawDeg, double now){
+    if(scan.ranges.empty() || scan.angleIncrement <= 0){
+        return;
+    }
+
+    int stride = std::max(1, (int) std::lround(Deg2Rad(candidateRaySpacing) / scan.angleIncrement));
+
+    for(size_t i = 0; i < scan.ranges.size(); i += stride){
+        float rayAngle = Rad2Deg(scan.angleMin + i * scan.angleIncrement);
+        float worldBearing = yawDeg + rayAngle;
+
+        // 1. Coverage: the bearing was inside the fan whether or not the ray returned
+        BearingCoverage &coverage = candidates.bearings[wrapBearing((int) std::lround(worldBearing))];
+        coverage = {now, posX, posY};
+
+        // 2. Endpoint, deduplicated per cell with the newest observation replacing the old one
+        float range = scan.ranges[i];
+        if(!std::isfinite(range) || range < scan.rangeMin || range > scan.rangeMax) continue;
+
+        insertPoint(candidates.points, posX + range * std::cos(Deg2Rad(worldBearing)), posY + range * std::sin(Deg2Rad(worldBearing)));
+    }
+}
+
+bool bearingFresh(int bearingDeg, float posX, float posY, double now){
+    const BearingCoverage &coverage = candidates.bearings[wrapBearing(bearingDeg)];
+    return coverage.stamp > 0
+        && now - coverage.stamp < bearingMaxAge
+        && distanceBetween(coverage.x, coverage.y, posX, posY) < bearingMaxDisplacement;
+}
+
+float unobservedBearingFraction(float posX, float posY, double now){
+    int unobserved = 0;
+    for(int b = 0; b < 360; b++){
+        if(!bearingFresh(b, posX, posY, now)){
+            unobserved++;
+        }
+    }
+    return unobserved / 360.0f;
+}
+
+bool uncoveredTurn(float posX, float posY, float yawDeg, float halfFovDeg, double now, float &ccwDeg, float &cwDeg){
+    ccwDeg = 0;
+    cwDeg = 0;
+    bool any = false;
+
+    for(int b = 0; b < 360; b++){
+        if(bearingFresh(b, posX, posY, now)) continue;
+
+        // Bearings inside the current fan get covered by the next scan without turning
+        float offset = b - yawDeg;
+        while(offset > 180) offset -= 360;
+        while(offset < -180) offset += 360;
+        if(std::abs(offset) <= halfFovDeg) continue;
+
+        any = true;
+
+        // Rotation needed for the leading edge of the fan to reach b in each direction
+        float ccw = b - (yawDeg + halfFovDeg);
+        float cw = (yawDeg - halfFovDeg) - b;
+        while(ccw < 0) ccw += 360;
+        while(ccw >= 360) ccw -= 360;
+        while(cw < 0) cw += 360;
+        while(cw >= 360) cw -= 360;
+
+        ccwDeg = std::max(ccwDeg, ccw);
+        cwDeg = std::max(cwDeg, cw);
+    }
+    return any;
+}
+
+void collectCandidates(float posX, float posY, std::vector<std::array<float, 2>> &sweptPoints){
+    for(size_t i = 0; i < gridSize(candidates.points); i++){
+        const GridCell &cell = gridCell(candidates.points, i);
+        if(distanceBetween(posX, posY, cell.x, cell.y) < distanceLimit){
+            sweptPoints.push_back({cell.x, cell.y});
+        }
+    }
+}
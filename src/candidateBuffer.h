@@ -0,0 +1,39 @@
+#ifndef candidateBufferHeader
+#define candidateBufferHeader
+
+#include "common.h"
+#include "pointGrid.h"
+
+// Destination candidates gathered from every scan while the robot drives, so biased explore
+// does not have to stop and sweep for directions it has already seen. Endpoints are kept one per
+// spatial cell (newest wins), and each one-degree world bearing remembers when and from where it
+// was last covered by the scan fan.
+
+struct BearingCoverage{
+    double stamp;       // Time the bearing was last inside the fan, zero or negative if never
+    float x;            // Robot position at that time
+    float y;
+};
+
+struct CandidateBuffer{
+    PointGrid points;
+    std::array<BearingCoverage, 360> bearings;
+};
+
+extern CandidateBuffer candidates;
+
+void resetCandidates();
+
+void observeScanCandidates(const ScanStruct &scan, float posX, float posY, float yawDeg, double now);
+
+bool bearingFresh(int bearingDeg, float posX, float posY, double now);
+
+float unobservedBearingFraction(float posX, float posY, double now);
+
+// Whether any bearing outside the current fan is stale, and if so how far the robot has to turn
+// counterclockwise or clockwise for the fan to sweep over all of them
+bool uncoveredTurn(float posX, float posY, float yawDeg, float halfFovDeg, double now, float &ccwDeg, float &cwDeg);
+
+void collectCandidates(float posX, float posY, std::vector<std::array<float, 2>> &sweptPoints);
+
+#endif
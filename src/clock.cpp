@@ -0,0 +1,40 @@
+#include "clock.h"
+#include "replay.h"
+
+static uint64_t lastClockNs = 0;
+
+void waitForClock(){
+    if(ros::Time::isSimTime()){
+        ROS_INFO("waitForClock() | waiting for /clock...");
+    }
+    ros::Time::waitForValid();
+}
+
+double clockNow(){
+    return clockNowNs() * 1e-9;
+}
+
+uint64_t clockNowNs(){
+    uint64_t now = lastClockNs;
+    if(replayInput(REPLAY_CLOCK, &now, sizeof(now))){
+        lastClockNs = now;      // Held once the log runs out
+        return now;
+    }
+    now = ros::Time::now().toNSec();
+    recordInput(REPLAY_CLOCK, &now, sizeof(now));
+    return now;
+}
+
+uint64_t clockLiveNs(){
+    return ros::Time::now().toNSec();
+}
+
+void clockSleep(double seconds){
+    if(replaying()) return;
+    ros::Duration(seconds).sleep();
+}
+
+void ClockRate::sleep(){
+    if(replaying()) return;
+    rate.sleep();
+}
@@ -0,0 +1,35 @@
+#ifndef clockHeader
+#define clockHeader
+
+#include "common.h"
+
+// Controller time. Every timeout, deadline, rate and budget that shapes the robot's behavior
+// reads this clock, which follows ROS time and so /clock under use_sim_time: Gazebo or a
+// headless sim can run at any real-time factor and the node behaves the same. std::chrono is
+// left to profiling (metrics.h, the event log, DWA timing), which measures the CPU, not the robot.
+// Control thread reads are recorded and replayed (replay.h), and nothing sleeps in replay.
+
+// Blocks until the clock is valid, i.e. until the first /clock message under use_sim_time
+void waitForClock();
+
+double clockNow();
+
+uint64_t clockNowNs();
+
+// The same clock, never recorded: for message arrival stamps and the background threads, which
+// are not part of a replay
+uint64_t clockLiveNs();
+
+void clockSleep(double seconds);
+
+// ros::Rate for the control loops
+class ClockRate{
+public:
+    explicit ClockRate(double hz) : rate(hz) {}
+    void sleep();
+
+private:
+    ros::Rate rate;
+};
+
+#endif
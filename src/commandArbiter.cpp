@@ -0,0 +1,106 @@
+#include "commandArbiter.h"
+#include "clock.h"
+#include "replay.h"
+
+#include <atomic>
+#include <mutex>
+
+float arbiterRate = 30;         // Hz, the Kinect scan rate
+
+struct CommandRequest{
+    geometry_msgs::Twist twist;
+    uint64_t deadlineNs;
+    CommandTag tag;
+    bool active;
+};
+
+static CommandRequest requests[SOURCE_COUNT];
+static std::mutex requestsMutex;
+static std::thread arbiterThread;
+static std::atomic<bool> arbiterOn{false};
+static std::atomic<int> lastWinner{SOURCE_COUNT};
+static ros::Publisher arbiter_pub;
+
+static const CommandSource behaviorSources[BEHAVIOR_COUNT] = {
+    SOURCE_DEFAULT, SOURCE_WALL_FOLLOWING, SOURCE_NAVIGATION, SOURCE_BUMPER_RECOVERY
+};
+
+CommandSource behaviorSource(Behavior behavior){
+    return behaviorSources[behavior];
+}
+
+void submitCommand(CommandSource source, const geometry_msgs::Twist &twist, double lifetime, const CommandTag &tag){
+    uint64_t deadline = clockLiveNs() + (uint64_t) (lifetime * 1e9);
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    requests[source] = {twist, deadline, tag, true};
+}
+
+void cancelCommand(CommandSource source){
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    requests[source].active = false;
+}
+
+bool arbiterPreempted(CommandSource source){
+    uint8_t preempted = 0;
+    if(replayInput(REPLAY_PREEMPTED, &preempted, sizeof(preempted))){
+        return preempted;
+    }
+    preempted = lastWinner.load(std::memory_order_relaxed) < source;
+    recordInput(REPLAY_PREEMPTED, &preempted, sizeof(preempted));
+    return preempted;
+}
+
+bool arbiterRunning(){
+    return arbiterOn.load(std::memory_order_relaxed);
+}
+
+static void arbiterLoop(){
+    // ros::Rate does not make up a late period with a burst of publishes
+    ros::Rate rate(arbiterRate);
+    bool published = false;     // Whether the last period sent a source's command
+
+    while(arbiterOn && ros::ok()){
+        CommandRequest winner = {geometry_msgs::Twist(), 0, {0, 0, BEHAVIOR_OTHER}, false};
+        int source = SOURCE_COUNT;
+        {
+            uint64_t now = clockLiveNs();
+            std::lock_guard<std::mutex> lock(requestsMutex);
+            for(int s = 0; s < SOURCE_COUNT; s++){
+                if(requests[s].active && requests[s].deadlineNs > now){
+                    winner = requests[s];
+                    source = s;
+                    break;
+                }
+                requests[s].active = false;
+            }
+        }
+
+        lastWinner.store(source, std::memory_order_relaxed);
+        if(winner.active){
+            arbiter_pub.publish(winner.twist);
+            traceCommand(winner.tag, clockLiveNs() * 1e-9);
+        }
+        else if(published){
+            arbiter_pub.publish(winner.twist);  // Zero once after the last source lets go
+        }
+        published = winner.active;
+
+        rate.sleep();
+    }
+}
+
+void startArbiter(ros::Publisher &vel_pub){
+    if(arbiterOn) return;
+    arbiter_pub = vel_pub;
+    arbiterOn = true;
+    arbiterThread = std::thread(arbiterLoop);
+}
+
+void stopArbiter(){
+    arbiterOn = false;
+    if(arbiterThread.joinable()) arbiterThread.join();
+
+    // Leave the robot stopped
+    geometry_msgs::Twist stop;
+    arbiter_pub.publish(stop);
+}
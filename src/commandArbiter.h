@@ -0,0 +1,43 @@
+#ifndef commandArbiterHeader
+#define commandArbiterHeader
+
+#include "common.h"
+#include "commandTrace.h"
+
+// In-process command mux. Every source submits a twist with a lifetime; once per control
+// period the arbiter thread publishes the request of the highest priority source whose
+// deadline has not passed. A higher priority request takes over at the next period whatever
+// the lower source is doing, and a source that stops submitting (blocked, crashed, finished)
+// drops out when its deadline passes. When the last one drops out the arbiter publishes a
+// single zero twist and then nothing, leaving the velocity mux input to other nodes.
+// The arbiter thread also closes the scan-to-command traces (commandTrace.h) of what it publishes.
+
+enum CommandSource {            // Highest priority first
+    SOURCE_CANCEL_STOP,         // E-stop and end of contest, see cancelToken.h
+    SOURCE_SAFETY_STOP,
+    SOURCE_BUMPER_RECOVERY,
+    SOURCE_NAVIGATION,
+    SOURCE_WALL_FOLLOWING,
+    SOURCE_DEFAULT,             // Sweeps, turns and anything outside a behavior scope
+    SOURCE_TELEOP,              // Shared control while no autonomous source is commanding, see joystick.h
+    SOURCE_COUNT
+};
+
+extern float arbiterRate;       // Hz, one publish per period
+
+void startArbiter(ros::Publisher &vel_pub);
+
+void stopArbiter();
+
+bool arbiterRunning();
+
+void submitCommand(CommandSource source, const geometry_msgs::Twist &twist, double lifetime, const CommandTag &tag);
+
+void cancelCommand(CommandSource source);
+
+// True while the last published command came from a source above this one
+bool arbiterPreempted(CommandSource source);
+
+CommandSource behaviorSource(Behavior behavior);
+
+#endif
@@ -0,0 +1,41 @@
+#include "commandTrace.h"
+#include "metrics.h"
+#include "eventLog.h"
+
+static CommandTag latestTag = {0, 0, BEHAVIOR_OTHER};
+static double lastTracedScan = 0;
+
+static const MetricId behaviorMetrics[BEHAVIOR_COUNT] = {
+    METRIC_SCAN_TO_CMD_OTHER, METRIC_SCAN_TO_CMD_WALL_FOLLOWING, METRIC_SCAN_TO_CMD_NAVIGATION, METRIC_SCAN_TO_CMD_BUMPER_RECOVERY
+};
+
+BehaviorScope::BehaviorScope(Behavior behavior) : previous(latestTag.behavior){
+    latestTag.behavior = behavior;
+}
+
+BehaviorScope::~BehaviorScope(){
+    latestTag.behavior = previous;
+}
+
+void noteScanStamp(double stamp){
+    latestTag.scanStamp = stamp;
+}
+
+void noteOdomStamp(double stamp){
+    latestTag.odomStamp = stamp;
+}
+
+CommandTag currentCommandTag(){
+    return latestTag;
+}
+
+void traceCommand(const CommandTag &tag, double publishTime){
+    if(tag.scanStamp <= 0 || tag.scanStamp == lastTracedScan){
+        return;
+    }
+    lastTracedScan = tag.scanStamp;
+
+    double latency = std::max(0.0, publishTime - tag.scanStamp);
+    recordMetricNs(behaviorMetrics[tag.behavior], (uint64_t) (latency * 1e9));
+    logEvent(EV_COMMAND_LATENCY, tag.behavior, latency * 1e3, std::max(0.0, publishTime - tag.odomStamp) * 1e3);
+}
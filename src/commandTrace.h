@@ -0,0 +1,37 @@
+#ifndef commandTraceHeader
+#define commandTraceHeader
+
+#include "common.h"
+
+// Scan-to-command latency. Every published command is tagged with the stamps of the newest
+// scan and odometry it could have been computed from and with the behavior that produced it.
+// The first command after each new scan closes that scan's trace: publish time minus
+// header.stamp is recorded in the behavior's latency histogram (see metrics.h) and the event log.
+
+enum Behavior { BEHAVIOR_OTHER, BEHAVIOR_WALL_FOLLOWING, BEHAVIOR_NAVIGATION, BEHAVIOR_BUMPER_RECOVERY, BEHAVIOR_COUNT };
+
+struct CommandTag{
+    double scanStamp;   // header.stamp of the newest scan, s
+    double odomStamp;   // header.stamp of the newest odometry, s
+    Behavior behavior;
+};
+
+// Marks commands published inside the scope as coming from a behavior; scopes nest, so a
+// bumper recovery inside a navigation is traced as recovery and navigation resumes after it
+struct BehaviorScope{
+    explicit BehaviorScope(Behavior behavior);
+    ~BehaviorScope();
+    Behavior previous;
+};
+
+void noteScanStamp(double stamp);
+
+void noteOdomStamp(double stamp);
+
+CommandTag currentCommandTag();
+
+// Called for every command by the thread that publishes it: the arbiter thread while it runs,
+// otherwise publishVelocity on the control thread. Never from both at once, see metrics.h.
+void traceCommand(const CommandTag &tag, double publishTime);
+
+#endif
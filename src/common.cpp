@@ -1,5 +1,7 @@
 #include "common.h"
 
+float robotRadius = 0.18;   // Kobuki base radius (m)
+
 float absPow(float base, float exp){
     if(base < 0){
         return (float) -1*pow(-1*base, exp);
@@ -71,12 +71,24 @@ struct DistancesStruct{
 extern DistancesStruct distances;
 extern uint16_t nLasers;
 
+struct ScanStruct{
+    std::vector<float> ranges;
+    float angleMin;
+    float angleIncrement;
+    float rangeMin;
+    float rangeMax;
+};
+
+extern ScanStruct scan;
+
 #pragma endregion
 
 #pragma region Movement
 
 extern float angular;
 extern float linear;
+extern float minLinear, maxLinear;
+extern float minAngular, maxAngular;
 extern float posX, posY, yaw;
 
 #pragma endregion
@@ -88,6 +100,8 @@ extern std::vector<std::pair<double, double>> positions;
 #pragma endregion
 
 
+extern float robotRadius;
+
 #pragma region Functions
 
 float absPow(float base, float exp);
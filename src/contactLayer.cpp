@@ -0,0 +1,122 @@
+#include "contactLayer.h"
+#include "distanceField.h"
+
+float contactCellSize = 0.05;       // m, the gmapping resolution
+float contactInflation = 0.4;       // Clearance is tracked out to this distance from a mark (m)
+float contactDepth = 0.03;          // Marks sit this far outside the bumper shell (m)
+float contactArcStep = 10;          // Degrees between marks along a bumper arc
+size_t contactCapacity = 32768;     // Table slots, a power of two
+
+// Bearing span of each kobuki bumper in the robot frame (degrees), indexed LEFT, CENTER, RIGHT
+const float contactArcFrom[3] = {20, -20, -70};
+const float contactArcTo[3] = {70, 20, -20};
+
+ContactLayer contactLayer = {contactCellSize, std::vector<ContactCell>(contactCapacity), {}, contactCapacity - 1, 0};
+
+static size_t cellHash(int32_t ix, int32_t iy){
+    return ((uint32_t) ix * 73856093u) ^ ((uint32_t) iy * 19349663u);
+}
+
+static const ContactCell *findContactCell(int32_t ix, int32_t iy){
+    for(size_t slot = cellHash(ix, iy) & contactLayer.mask; ; slot = (slot + 1) & contactLayer.mask){
+        const ContactCell &cell = contactLayer.table[slot];
+        if(!cell.used) return nullptr;
+        if(cell.ix == ix && cell.iy == iy) return &cell;
+    }
+}
+
+// Returns the slot, inserting the cell if needed; -1 once the table is three quarters full
+static int64_t claimContactCell(int32_t ix, int32_t iy){
+    for(size_t slot = cellHash(ix, iy) & contactLayer.mask; ; slot = (slot + 1) & contactLayer.mask){
+        ContactCell &cell = contactLayer.table[slot];
+        if(cell.used && cell.ix == ix && cell.iy == iy) return slot;
+        if(!cell.used){
+            if(4 * (contactLayer.used + 1) > 3 * contactLayer.table.size()) return -1;
+            cell = {ix, iy, contactInflation, 0, true};
+            contactLayer.used++;
+            return slot;
+        }
+    }
+}
+
+static void markContact(float mx, float my){
+    int32_t cx = (int32_t) std::floor(mx / contactLayer.cellSize);
+    int32_t cy = (int32_t) std::floor(my / contactLayer.cellSize);
+
+    int64_t centre = claimContactCell(cx, cy);
+    if(centre < 0){
+        ROS_WARN("recordBumperContact() | Contact layer full, hit not recorded.");
+        return;
+    }
+    ContactCell &mark = contactLayer.table[centre];
+    if(mark.hits == 0) contactLayer.marks.push_back((uint32_t) centre);
+    if(mark.hits < UINT16_MAX) mark.hits++;
+
+    // Stamp the distance to this mark on every cell of the surrounding disc
+    int radius = (int) std::ceil(contactInflation / contactLayer.cellSize);
+    for(int dy = -radius; dy <= radius; dy++){
+        for(int dx = -radius; dx <= radius; dx++){
+            float d = std::hypot((float) dx, (float) dy) * contactLayer.cellSize;
+            if(d > contactInflation) continue;
+
+            int64_t slot = claimContactCell(cx + dx, cy + dy);
+            if(slot < 0) return;
+            ContactCell &cell = contactLayer.table[slot];
+            cell.clearance = std::min(cell.clearance, d);
+        }
+    }
+}
+
+void recordBumperContact(uint8_t bumperSide, float posX, float posY, float yawDeg){
+    if(bumperSide > 2) return;
+
+    float reach = robotRadius + contactDepth;
+    for(float bearing = contactArcFrom[bumperSide]; bearing <= contactArcTo[bumperSide] + 1e-3f; bearing += contactArcStep){
+        float heading = Deg2Rad(yawDeg + bearing);
+        float mx, my;
+        odomToMapPoint(posX + reach * std::cos(heading), posY + reach * std::sin(heading), mx, my);
+        markContact(mx, my);
+    }
+}
+
+float contactClearance(float x, float y){
+    if(contactLayerEmpty()) return contactInflation;
+
+    float mx, my;
+    odomToMapPoint(x, y, mx, my);
+    const ContactCell *cell = findContactCell((int32_t) std::floor(mx / contactLayer.cellSize), (int32_t) std::floor(my / contactLayer.cellSize));
+    return cell ? cell->clearance : contactInflation;
+}
+
+float contactSegmentClearance(float x0, float y0, float x1, float y1){
+    if(contactLayerEmpty()) return contactInflation;
+
+    // Samples two cells apart are still far closer together than a contactInflation disc is wide
+    float length = distanceBetween(x0, y0, x1, y1);
+    int steps = std::max(1, (int) std::ceil(length / (2 * contactLayer.cellSize)));
+
+    float nearest = contactInflation;
+    for(int k = 0; k <= steps; k++){
+        float t = (float) k / steps;
+        nearest = std::min(nearest, contactClearance(x0 + t * (x1 - x0), y0 + t * (y1 - y0)));
+    }
+    return nearest;
+}
+
+void gatherContactObstacles(float posX, float posY, float yawDeg, float range, DwaObstacles &obstacles){
+    float c = std::cos(Deg2Rad(yawDeg));
+    float s = std::sin(Deg2Rad(yawDeg));
+
+    for(uint32_t slot : contactLayer.marks){
+        const ContactCell &mark = contactLayer.table[slot];
+        float x, y;
+        mapToOdomPoint((mark.ix + 0.5f) * contactLayer.cellSize, (mark.iy + 0.5f) * contactLayer.cellSize, x, y);
+
+        float dx = x - posX;
+        float dy = y - posY;
+        if(dx * dx + dy * dy > range * range) continue;
+
+        obstacles.x.push_back(c * dx + s * dy);
+        obstacles.y.push_back(-s * dx + c * dy);
+    }
+}
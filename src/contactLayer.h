@@ -0,0 +1,45 @@
+#ifndef contactLayerHeader
+#define contactLayerHeader
+
+#include "common.h"
+#include "dwaPlanner.h"
+
+// Obstacles found with the bumper rather than the scan: low or dark objects the Kinect misses.
+// Each hit marks the arc of the bumper that was pressed, just outside the robot, in map-frame
+// cells so the marks stay put when gmapping corrects odometry. Every cell within
+// contactInflation of a mark stores its distance to the nearest mark, so a clearance query is
+// one hash lookup.
+
+struct ContactCell{
+    int32_t ix;
+    int32_t iy;
+    float clearance;    // Distance to the nearest contact mark (m)
+    uint16_t hits;      // Bumper hits that marked this cell, 0 for inflation-only cells
+    bool used;
+};
+
+struct ContactLayer{
+    float cellSize;
+    std::vector<ContactCell> table;     // Power of two slots, open addressed
+    std::vector<uint32_t> marks;        // Slots with hits > 0
+    size_t mask;
+    size_t used;
+};
+
+extern ContactLayer contactLayer;
+
+// Mark the bumper arc of one press. bumperSide is a kobuki_msgs::BumperEvent bumper index.
+void recordBumperContact(uint8_t bumperSide, float posX, float posY, float yawDeg);
+
+// Distance (m) from an odom-frame point to the nearest contact mark, capped at contactInflation
+float contactClearance(float x, float y);
+
+// Smallest contactClearance along the segment between two odom-frame points
+float contactSegmentClearance(float x0, float y0, float x1, float y1);
+
+inline bool contactLayerEmpty(){ return contactLayer.marks.empty(); }
+
+// Append marks within range of the robot to a planner obstacle set, in the robot frame
+void gatherContactObstacles(float posX, float posY, float yawDeg, float range, DwaObstacles &obstacles);
+
+#endif
@@ -4,9 +4,22 @@
 #include "movement.h"
 #include "biasedExplore.h"
 #include "wallFollowing.h"
+#include "candidateBuffer.h"
 #include <ros/ros.h>
 #include <geometry_msgs/PoseStamped.h>
-#include <visualization_msgs/Marker.h>
+#include <cstring>
+#include "visualization.h"
+#include "tfCache.h"
+#include "eventLog.h"
+#include "metrics.h"
+#include "commandTrace.h"
+#include "sensorMailbox.h"
+#include "watchdog.h"
+#include "cancelToken.h"
+#include "joystick.h"
+#include "exploreScheduler.h"
+#include "replay.h"
+#include "clock.h"
 
 
 // Define global publishers declared as extern in bumper.h
@@ -16,45 +29,37 @@ ros::Publisher marker_pub;
 
 enum Mode {WALL_FOLLOW, RANDOM_NAVIGATE};
 
-
-int main(int argc, char **argv)
-{
-    
-    ros::init(argc, argv, "image_listener");
-    ros::NodeHandle nh;
-
-
-    // Subscribers
-    ros::Subscriber bumper_sub = nh.subscribe("mobile_base/events/bumper", 10, &bumperCallback);
-    ros::Subscriber laser_sub = nh.subscribe("scan", 10, &laserCallback);
-    ros::Subscriber subOdom = nh.subscribe("odom", 1, &odomCallback);
-
-
-    // Publishers
-    ros::Publisher vel_pub = nh.advertise<geometry_msgs::Twist>("cmd_vel_mux/input/teleop", 1);
-    pose_pub = nh.advertise<geometry_msgs::PoseStamped>("bumper_pose", 10);
-    marker_pub = nh.advertise<visualization_msgs::Marker>("visualization_marker", 10);
+const char *eventLogPath = "contest1_events.bin";   // Relative to the node's working directory, ~/.ros under roslaunch
+const double contestDuration = 480;                 // s, every primitive is cancelled when it runs out
+const float plannedPathClearance = 0.3;             // m kept from mapped walls by planned paths
+const float pathGoalTolerance = 0.45;               // Paths end this close to the candidate, as DWA trips do
 
 
-    ros::Rate loop_rate(10);
+// Everything the control thread does from here on reads its inputs through spinSensors(),
+// controlOk(), the clock and the taps in replay.h, so a recorded run can be replayed through it
+static void runContest(ros::Publisher &vel_pub)
+{
+    const float mainLoopRate = 10;     // Hz
+    ClockRate loop_rate(mainLoopRate);
+    uint64_t lastLoopNs = 0;
     geometry_msgs::Twist vel;
 
 
-    // contest count down timer
-    std::chrono::time_point<std::chrono::system_clock> start;
-    start = std::chrono::system_clock::now();
-    uint64_t secondsElapsed = 0;
+    // Contest clock, decides what exploration spends the remaining time on
+    startExploreScheduler(contestDuration);
 
 
     angular = 0.0;
     linear = 0.0;
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
 
     std::vector<std::array<float, 2>> sweptPoints;
     std::vector<std::array<float, 2>> visitedPoints;
+    PointGrid candidateGrid(0.25, 16384);
+    PointGrid visitedGrid(0.5, 4096);
     float nextX, nextY;
 
 
@@ -63,27 +68,14 @@ int main(int argc, char **argv)
     #pragma region wallFollowing Param
     const float target_distance = 0.9;
     const float safe_threshold = 1.0;  // Safe distance threshold
-    const double k = 0.17;   // Scaling factor for angular velocity
-    const double alpha = 1.8; // Exponential growth/decay rate
-    const float max_speed = 0.25;  // Max linear speed
     const float min_speed = 0.1;   // Min linear speed
-    float current_x;
-    float current_y;
-    float delta_x;
-    float delta_y;
-    int corridor_count = 0;
     bool wall_following = false;
 
 
-    // 全局变量：存储上一帧的左/右激光读数
-    bool prev_turn = false;
-    bool curr_turn = false;
-
-
     float prev_left_distance = 0.0, prev_right_distance = 0.0;
+    WallFollowState wallState = {};
 
 
-    float front_dist;
     float left_dist;
     float right_dist;
 
@@ -118,27 +110,37 @@ int main(int argc, char **argv)
     }
 
     findFirstDestination(posX, posY, sweptPoints, visitedPoints, nextX, nextY);
+    for(size_t i = 0; i < visitedPoints.size(); i++){
+        insertPoint(visitedGrid, visitedPoints[i][0], visitedPoints[i][1]);
+    }
     rotateToStarting(nextX, nextY, vel, vel_pub);
  
 
 
-    while(ros::ok()) {
-        ros::spinOnce();
+    while(controlOk() && !motionCancel.requested(CANCEL_CONTEST_TIMER)) {
+        spinSensors();
+
+        // Hold still while the e-stop is down, the arbiter is already publishing zero
+        if(motionCancel.requested(CANCEL_ESTOP)){
+            clockSleep(1.0 / mainLoopRate);
+            continue;
+        }
 
 
         switch (mode) {
             case WALL_FOLLOW: {
+                ScopedMetric tick(METRIC_WALL_FOLLOW_TICK);
+                BehaviorScope behavior(BEHAVIOR_WALL_FOLLOWING);
+                recordDataAge(METRIC_SCAN_AGE, scanReceivedTicks);
+                recordDataAge(METRIC_ODOM_AGE, odomReceivedTicks);
 
                 get_coord();
                 corners = filter_corner();
 
                 // Check distances
-                front_dist = std::isnan(distances.frontRay) ? safe_threshold : distances.frontRay;
                 left_dist = std::isnan(distances.leftRay) ? safe_threshold : distances.leftRay;
                 right_dist = std::isnan(distances.rightRay) ? safe_threshold : distances.rightRay;
 
-                curr_turn = false;
-
                 // Determine if wall is being followed based on left and right distances
                 left_change = left_dist - prev_left_distance;
                 right_change = right_dist - prev_right_distance;
@@ -149,57 +151,38 @@ int main(int argc, char **argv)
                 // Main Wall Following Algorithm
                 if (left_change > corridor_threshold && wall_following) {
                 
-                    ROS_WARN("Detected corridor on the LEFT!");
+                    logEvent(EV_CORRIDOR_LEFT, left_change);
                    
                     vel.angular.z = 0.0;  // No adjustment needed
 
-                    // Initialize current position if this is the first corridor detection
-                    if (corridor_count < 1) {
-                        current_x = posX;
-                        current_y = posY;
-                        corridor_count += 1;
-                    }
-
-
                     moveRobot(distances.leftVertPrev, 0, vel, vel_pub);
-                    ROS_WARN("front distance move %.1f°", distances.leftVertPrev);
+                    logEvent(EV_CORRIDOR_ADVANCE, distances.leftVertPrev);
                     wall_following = false;
                 }
 
 
                 else if (right_change > corridor_threshold && wall_following) {
 
-                    ROS_WARN("Detected corridor on the RIGHT!");
+                    logEvent(EV_CORRIDOR_RIGHT, right_change);
                     vel.angular.z = 0.0;  // No adjustment needed
 
-                    // Initialize current position if this is the first corridor detection
-                    if (corridor_count < 1) {
-                        current_x = posX;
-                        current_y = posY;
-                        corridor_count += 1;
-                    }
-
-
                     moveRobot(distances.rightVertPrev, 0, vel, vel_pub);
-                    ROS_WARN("front distance move %.1f°", distances.rightVertPrev);
+                    logEvent(EV_CORRIDOR_ADVANCE, distances.rightVertPrev);
                     wall_following = false;
                 }
 
 
                 else {
-                
-                    WallSide wall_side = LEFT; // Change to RIGHT to follow the right wall
-                  
-                    wallFollowing(wall_side, distances, curr_turn, prev_turn, left_dist, right_dist, front_dist, target_distance, min_speed, k, alpha, vel, vel_pub);
+                    // Change to wallFollowingPD<RIGHT> to follow the right wall
+                    wallFollowingPD<LEFT>(wallState, target_distance, min_speed, vel, vel_pub);
                 }
 
 
                 prev_left_distance = left_dist;
                 prev_right_distance = right_dist;
-                prev_turn = curr_turn;
 
 
-                vel_pub.publish(vel);
+                publishVelocity(vel, vel_pub);
 
 
                 // Loop Checker
@@ -210,33 +193,152 @@ int main(int argc, char **argv)
                     break;  // Stop wall-following
                 }
 
+                // Travelling between candidates is expected to map faster, or time is running out
+                if (leaveWallFollowing()) {
+                    mode = RANDOM_NAVIGATE;
+                    break;
+                }
+
 
                 break;
             }
             case RANDOM_NAVIGATE: {
                 sweptPoints.clear();
-                sweep360(sweptPoints, vel, vel_pub);
+
+                // Candidates are gathered from every scan while driving, only sweep when turning
+                // is expected to map more per second than driving to the next candidate
+                float halfFov = Rad2Deg(scan.ranges.size() * scan.angleIncrement) / 2;
+                float ccw, cw;
+                float sweepTurn = 0;
+                if(uncoveredTurn(posX, posY, yaw, halfFov, clockNow(), ccw, cw)){
+                    sweepTurn = std::min(ccw, cw);
+                }
+                if(chooseExploreAction(sweepTurn, halfFov) == ACTION_SWEEP){
+                    beginExploreAction(ACTION_SWEEP);
+                    sweepUnobserved(sweptPoints, vel, vel_pub);
+                    endExploreAction(ACTION_SWEEP);
+                }
+                else {
+                    collectCandidates(posX, posY, sweptPoints);
+                }
+                if(sweptPoints.empty()){
+                    beginExploreAction(ACTION_SWEEP);
+                    sweep360(sweptPoints, vel, vel_pub);
+                    endExploreAction(ACTION_SWEEP);
+                }
                 ROS_INFO("Size: %zu", sweptPoints.size());
                
-                findNextDestination(posX, posY, sweptPoints, visitedPoints, nextX, nextY);
+                clearPointGrid(candidateGrid);
+                for(size_t i = 0; i < sweptPoints.size(); i++){
+                    insertPoint(candidateGrid, sweptPoints[i][0], sweptPoints[i][1]);
+                }
 
+                findNextDestination(posX, posY, candidateGrid, visitedGrid, nextX, nextY);
 
-                ROS_INFO("----------------Visited Positions----------------");
-                for(int i = 0; i < visitedPoints.size(); i++){
-                    ROS_INFO("(%.2f,%.2f)", visitedPoints[i][0], visitedPoints[i][1]);
-                }
+                setSceneCandidates(candidateGrid);
+                setSceneVisited(visitedGrid);
+                setSceneTarget(nextX, nextY);
 
 
-                navigateToPosition(nextX, nextY, vel, vel_pub);  
+                // A path that bends around mapped walls is tracked in one motion, a straight shot or
+                // a target off the map goes to the DWA planner
+                std::vector<std::array<float, 2>> path;
+                bool reached;
+                beginExploreAction(ACTION_TRAVEL);
+                if(esdfReady() && esdfPath(posX, posY, nextX, nextY, plannedPathClearance, pathGoalTolerance, path) && path.size() > 2){
+                    reached = followPath(path, vel, vel_pub);
+                }
+                else {
+                    reached = navigateToPositionSmart(nextX, nextY, vel, vel_pub);
+                }
+                if(!reached){
+                    // Unreachable from here, score it as visited so the next pick goes elsewhere
+                    insertPoint(visitedGrid, nextX, nextY);
+                }
+                endExploreAction(ACTION_TRAVEL);
                
                 break;
             }
         }
 
-        secondsElapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now()-start).count();
         loop_rate.sleep();
+
+        uint64_t loopNs = clockNowNs();     // Same clock as loop_rate
+        if(lastLoopNs != 0){
+            int64_t deviation = (int64_t) (loopNs - lastLoopNs) - (int64_t) (1e9 / mainLoopRate);
+            recordMetricNs(METRIC_LOOP_JITTER, std::abs(deviation));
+        }
+        lastLoopNs = loopNs;
+    }
+}
+
+
+// Value of a `--name value` command line option, null if absent
+static const char *optionValue(int argc, char **argv, const char *name){
+    for(int i = 1; i + 1 < argc; i++){
+        if(strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return nullptr;
+}
+
+int main(int argc, char **argv)
+{
+    // Replay runs the controller on a recorded log without a ROS master, as fast as it can
+    const char *replayPath = optionValue(argc, argv, "--replay");
+    if(replayPath){
+        ros::Time::init();
+        if(!startReplay(replayPath)) return 1;
+        startDwaPlanner();
+        ros::Publisher vel_pub;
+        runContest(vel_pub);
+        stopDwaPlanner();
+        return finishReplay();
+    }
+    const char *recordPath = optionValue(argc, argv, "--record");
+
+    ros::init(argc, argv, "image_listener");
+    ros::NodeHandle nh;
+    waitForClock();
+
+
+    // Subscribers: newest scan, pose and map only, every bumper edge
+    subscribeSensors(nh);
+
+
+    // Publishers
+    ros::Publisher vel_pub = nh.advertise<geometry_msgs::Twist>("cmd_vel_mux/input/teleop", 1);
+    pose_pub = nh.advertise<geometry_msgs::PoseStamped>("bumper_pose", 10);
+
+
+    startEventLog(eventLogPath);
+    startDwaPlanner();
+    startTfCache();
+    startVisualization(nh);
+    startMetrics(nh);
+    startArbiter(vel_pub);
+    startWatchdog();
+    startJoystick(nh);
+    startContestTimer(contestDuration);
+
+    if(recordPath){
+        startRecording(recordPath);
     }
 
+    runContest(vel_pub);
+
+    stopRecording();
+
+stopContestTimer();
+stopJoystick();
+stopWatchdog();
+stopArbiter();
+stopMetrics();
+dumpMetrics();
+stopVisualization();
+stopTfCache();
+stopSensors();
+stopDwaPlanner();
+stopEventLog();
 
 return 0;
 }
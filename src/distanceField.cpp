@@ -0,0 +1,328 @@
+#include "distanceField.h"
+#include "visualization.h"
+
+#include <queue>
+
+int occupiedThreshold = 65;     // OccupancyGrid value at or above which a cell is an obstacle
+float esdfMaxDistance = 2.0;    // Propagation stops beyond this (m)
+size_t pathMaxExpansions = 200000;  // Cells esdfPath() may expand before giving up
+
+DistanceField esdf = {0, 0, 0, 0, 0, {}, {}, {}, {}};
+
+float odomToMapX = 0, odomToMapY = 0, odomToMapCos = 1, odomToMapSin = 0;
+float mappedAreaM2 = 0;
+
+typedef std::pair<float, int32_t> QueueEntry;
+std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> esdfOpen;
+
+static float maxDistCells(){
+    return esdfMaxDistance / esdf.resolution;
+}
+
+static bool isOccupiedObstacle(int32_t o){
+    return o >= 0 && esdf.occupied[o];
+}
+
+static void clearCell(int32_t s){
+    esdf.dist[s] = maxDistCells();
+    esdf.obst[s] = -1;
+}
+
+static void setObstacle(int32_t s){
+    esdf.occupied[s] = 1;
+    esdf.obst[s] = s;
+    esdf.dist[s] = 0;
+    esdfOpen.push(QueueEntry(0, s));
+}
+
+static void removeObstacle(int32_t s){
+    esdf.occupied[s] = 0;
+    clearCell(s);
+    esdf.toRaise[s] = 1;
+    esdfOpen.push(QueueEntry(0, s));
+}
+
+// Raise: a cell lost its obstacle, so clear every neighbour that pointed at a removed obstacle
+// and requeue the rest so they can lower into the cleared region
+static void raise(int32_t s, int x, int y){
+    for(int dy = -1; dy <= 1; dy++){
+        for(int dx = -1; dx <= 1; dx++){
+            if(dx == 0 && dy == 0) continue;
+            int nx = x + dx, ny = y + dy;
+            if(nx < 0 || ny < 0 || nx >= esdf.width || ny >= esdf.height) continue;
+
+            int32_t n = ny * esdf.width + nx;
+            if(esdf.obst[n] < 0 || esdf.toRaise[n]) continue;
+
+            float priority = esdf.dist[n];
+            if(!isOccupiedObstacle(esdf.obst[n])){
+                clearCell(n);
+                esdf.toRaise[n] = 1;
+            }
+            esdfOpen.push(QueueEntry(priority, n));
+        }
+    }
+    esdf.toRaise[s] = 0;
+}
+
+// Lower: offer this cell's obstacle to the neighbours that are further from theirs
+static void lower(int32_t s, int x, int y){
+    int32_t o = esdf.obst[s];
+    int ox = o % esdf.width;
+    int oy = o / esdf.width;
+
+    for(int dy = -1; dy <= 1; dy++){
+        for(int dx = -1; dx <= 1; dx++){
+            if(dx == 0 && dy == 0) continue;
+            int nx = x + dx, ny = y + dy;
+            if(nx < 0 || ny < 0 || nx >= esdf.width || ny >= esdf.height) continue;
+
+            int32_t n = ny * esdf.width + nx;
+            if(esdf.toRaise[n]) continue;
+
+            float d = std::hypot((float) (nx - ox), (float) (ny - oy));
+            if(d < esdf.dist[n] && d <= maxDistCells()){
+                esdf.dist[n] = d;
+                esdf.obst[n] = o;
+                esdfOpen.push(QueueEntry(d, n));
+            }
+        }
+    }
+}
+
+static void updateDistanceField(){
+    while(!esdfOpen.empty()){
+        int32_t s = esdfOpen.top().second;
+        esdfOpen.pop();
+
+        int x = s % esdf.width;
+        int y = s / esdf.width;
+
+        if(esdf.toRaise[s]){
+            raise(s, x, y);
+        }
+        else if(isOccupiedObstacle(esdf.obst[s])){
+            lower(s, x, y);
+        }
+    }
+}
+
+void mapCallback(const nav_msgs::OccupancyGrid::ConstPtr& msg){
+    int width = msg->info.width;
+    int height = msg->info.height;
+
+    // gmapping grows the map as it explores. A change of geometry rebuilds from scratch; otherwise
+    // only the cells whose occupancy flipped are pushed through the brushfire.
+    bool rebuild = width != esdf.width || height != esdf.height
+        || msg->info.resolution != esdf.resolution
+        || msg->info.origin.position.x != esdf.originX
+        || msg->info.origin.position.y != esdf.originY;
+
+    if(rebuild){
+        esdf.width = width;
+        esdf.height = height;
+        esdf.resolution = msg->info.resolution;
+        esdf.originX = msg->info.origin.position.x;
+        esdf.originY = msg->info.origin.position.y;
+
+        esdf.occupied.assign(width * height, 0);
+        esdf.dist.assign(width * height, maxDistCells());
+        esdf.obst.assign(width * height, -1);
+        esdf.toRaise.assign(width * height, 0);
+    }
+
+    int32_t known = 0;
+    for(int32_t i = 0; i < width * height; i++){
+        known += msg->data[i] >= 0;
+        bool occupied = msg->data[i] >= occupiedThreshold;
+        if(occupied && !esdf.occupied[i]){
+            setObstacle(i);
+        }
+        else if(!occupied && esdf.occupied[i]){
+            removeObstacle(i);
+        }
+    }
+
+    mappedAreaM2 = known * esdf.resolution * esdf.resolution;
+
+    updateDistanceField();
+    setSceneFrontiers(*msg);
+}
+
+float mappedArea(){
+    return mappedAreaM2;
+}
+
+void setOdomToMap(float x, float y, float yawRad){
+    odomToMapX = x;
+    odomToMapY = y;
+    odomToMapCos = std::cos(yawRad);
+    odomToMapSin = std::sin(yawRad);
+}
+
+void odomToMapPoint(float x, float y, float &mx, float &my){
+    mx = odomToMapX + odomToMapCos * x - odomToMapSin * y;
+    my = odomToMapY + odomToMapSin * x + odomToMapCos * y;
+}
+
+void mapToOdomPoint(float mx, float my, float &x, float &y){
+    float dx = mx - odomToMapX;
+    float dy = my - odomToMapY;
+    x = odomToMapCos * dx + odomToMapSin * dy;
+    y = -odomToMapSin * dx + odomToMapCos * dy;
+}
+
+bool esdfReady(){
+    return esdf.width > 0 && esdf.height > 0;
+}
+
+// Odom-frame point to map cell, -1 if outside the map
+static int32_t odomToCell(float x, float y){
+    if(!esdfReady()) return -1;
+
+    float mx, my;
+    odomToMapPoint(x, y, mx, my);
+    int cx = (int) std::floor((mx - esdf.originX) / esdf.resolution);
+    int cy = (int) std::floor((my - esdf.originY) / esdf.resolution);
+
+    if(cx < 0 || cy < 0 || cx >= esdf.width || cy >= esdf.height) return -1;
+    return cy * esdf.width + cx;
+}
+
+float esdfDistance(float x, float y){
+    int32_t s = odomToCell(x, y);
+    if(s < 0) return esdfMaxDistance;
+    return esdf.dist[s] * esdf.resolution;
+}
+
+bool esdfGradient(float x, float y, float &gx, float &gy){
+    int32_t s = odomToCell(x, y);
+    if(s < 0 || esdf.obst[s] < 0) return false;
+
+    // The direction from the nearest obstacle is the exact gradient of the distance field
+    int32_t o = esdf.obst[s];
+    float dx = (o % esdf.width - s % esdf.width);
+    float dy = (o / esdf.width - s / esdf.width);
+    float norm = std::hypot(dx, dy);
+    if(norm < 1e-6f) return false;
+
+    // Back from map to odom axes (inverse rotation)
+    float mx = -dx / norm;
+    float my = -dy / norm;
+    gx = odomToMapCos * mx + odomToMapSin * my;
+    gy = -odomToMapSin * mx + odomToMapCos * my;
+    return true;
+}
+
+struct PathNode{
+    float cost;
+    int32_t parent;
+    bool closed;
+};
+
+static void cellToOdom(int32_t s, float &x, float &y){
+    float mx = esdf.originX + (s % esdf.width + 0.5f) * esdf.resolution;
+    float my = esdf.originY + (s / esdf.width + 0.5f) * esdf.resolution;
+    mapToOdomPoint(mx, my, x, y);
+}
+
+// Cells a and b see each other through passable cells, sampled every half cell
+static bool lineOfSight(int32_t a, int32_t b, float clearanceCells, float exemptCells, int sx, int sy){
+    int ax = a % esdf.width, ay = a / esdf.width;
+    int bx = b % esdf.width, by = b / esdf.width;
+    int steps = std::max(1, (int) std::ceil(2 * std::hypot((float) (bx - ax), (float) (by - ay))));
+    for(int i = 1; i < steps; i++){
+        int x = (int) std::lround(ax + (bx - ax) * (float) i / steps);
+        int y = (int) std::lround(ay + (by - ay) * (float) i / steps);
+        if(esdf.dist[y * esdf.width + x] < clearanceCells && std::hypot((float) (x - sx), (float) (y - sy)) > exemptCells){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool esdfPath(float x0, float y0, float x1, float y1, float clearance, float goalTolerance, std::vector<std::array<float, 2>> &path){
+    path.clear();
+    int32_t start = odomToCell(x0, y0);
+    int32_t goal = odomToCell(x1, y1);
+    if(start < 0 || goal < 0){
+        return false;
+    }
+
+    float clearanceCells = clearance / esdf.resolution;
+    float toleranceCells = goalTolerance / esdf.resolution;
+    int sx = start % esdf.width, sy = start / esdf.width;
+    int gx = goal % esdf.width, gy = goal / esdf.width;
+
+    // Octile distance to the edge of the goal disc
+    auto heuristic = [&](int x, int y){
+        int dx = std::abs(x - gx), dy = std::abs(y - gy);
+        float octile = std::max(dx, dy) + 0.41421356f * std::min(dx, dy);
+        return std::max(0.0f, octile - toleranceCells);
+    };
+
+    std::unordered_map<int32_t, PathNode> nodes;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    nodes[start] = {0, -1, false};
+    open.push(QueueEntry(heuristic(sx, sy), start));
+
+    int32_t reached = -1;
+    size_t expansions = 0;
+    while(!open.empty() && expansions < pathMaxExpansions){
+        int32_t s = open.top().second;
+        open.pop();
+        PathNode &node = nodes[s];
+        if(node.closed) continue;
+        node.closed = true;
+        expansions++;
+
+        int x = s % esdf.width, y = s / esdf.width;
+        if(std::hypot((float) (x - gx), (float) (y - gy)) <= toleranceCells){
+            reached = s;
+            break;
+        }
+
+        for(int dy = -1; dy <= 1; dy++){
+            for(int dx = -1; dx <= 1; dx++){
+                if(dx == 0 && dy == 0) continue;
+                int nx = x + dx, ny = y + dy;
+                if(nx < 0 || ny < 0 || nx >= esdf.width || ny >= esdf.height) continue;
+
+                int32_t n = ny * esdf.width + nx;
+                if(esdf.dist[n] < clearanceCells && std::hypot((float) (nx - sx), (float) (ny - sy)) > clearanceCells) continue;
+
+                float cost = node.cost + (dx != 0 && dy != 0 ? 1.41421356f : 1.0f);
+                auto found = nodes.find(n);
+                if(found != nodes.end() && (found->second.closed || found->second.cost <= cost)) continue;
+
+                nodes[n] = {cost, s, false};
+                open.push(QueueEntry(cost + heuristic(nx, ny), n));
+            }
+        }
+    }
+    if(reached < 0){
+        return false;
+    }
+
+    std::vector<int32_t> cells;
+    for(int32_t s = reached; s >= 0; s = nodes[s].parent){
+        cells.push_back(s);
+    }
+    std::reverse(cells.begin(), cells.end());
+
+    // Keep only the cells where line of sight from the last kept one breaks
+    path.push_back({x0, y0});
+    size_t anchor = 0;
+    for(size_t i = 2; i < cells.size(); i++){
+        if(!lineOfSight(cells[anchor], cells[i], clearanceCells, clearanceCells, sx, sy)){
+            anchor = i - 1;
+            float x, y;
+            cellToOdom(cells[anchor], x, y);
+            path.push_back({x, y});
+        }
+    }
+    float x, y;
+    cellToOdom(cells.back(), x, y);
+    path.push_back({x, y});
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef distanceFieldHeader
+#define distanceFieldHeader
+
+#include "common.h"
+#include <nav_msgs/OccupancyGrid.h>
+
+// Euclidean distance field over the gmapping occupancy grid, updated incrementally with the
+// dynamic brushfire of Lau et al. ("Improved updating of Euclidean distance maps and Voronoi
+// diagrams", IROS 2010). Each cell stores its distance and the coordinates of its nearest
+// obstacle, so a map update only touches the cells whose nearest obstacle changed, and a
+// query is a single array lookup.
+
+struct DistanceField{
+    int width;
+    int height;
+    float resolution;
+    double originX;     // Exactly as sent, a float copy of e.g. -12.85 would differ from every later /map
+    double originY;
+
+    std::vector<uint8_t> occupied;
+    std::vector<float> dist;        // Cells, capped at maxDistCells
+    std::vector<int32_t> obst;      // Index of the nearest obstacle cell, -1 if none
+    std::vector<uint8_t> toRaise;
+};
+
+extern DistanceField esdf;
+
+void mapCallback(const nav_msgs::OccupancyGrid::ConstPtr& msg);
+
+// Pose of the odom frame in the map frame, applied to every query made in odom coordinates
+void setOdomToMap(float x, float y, float yawRad);
+
+// Conversions between the odom and map frames using the pose given to setOdomToMap
+void odomToMapPoint(float x, float y, float &mx, float &my);
+void mapToOdomPoint(float mx, float my, float &x, float &y);
+
+bool esdfReady();
+
+// Area (m^2) of the gmapping grid known to be free or occupied, updated with every map
+float mappedArea();
+
+// Distance (m) from an odom-frame point to the nearest mapped obstacle. Points outside the map
+// or further than the propagation cap report the cap.
+float esdfDistance(float x, float y);
+
+// Unit vector pointing away from the nearest obstacle, in the odom frame. False if none is known.
+bool esdfGradient(float x, float y, float &gx, float &gy);
+
+// A* over the map cells that keep at least `clearance` (m) from every mapped obstacle, unknown
+// space counted as free, from (x0, y0) to any such cell within goalTolerance of (x1, y1). The
+// cells around the start are exempt so a robot close to a wall can leave it. The path is cut
+// down to the corners where line of sight breaks and returned in the odom frame, start first.
+// False if either end is off the map or nothing was found within pathMaxExpansions cells.
+bool esdfPath(float x0, float y0, float x1, float y1, float clearance, float goalTolerance, std::vector<std::array<float, 2>> &path);
+
+#endif
@@ -0,0 +1,282 @@
+#include "dwaPlanner.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+int dwaLinearSamples = 11;
+int dwaAngularSamples = 21;
+float dwaWindowTime = 0.25;     // Seconds of acceleration that bound the sampled window
+float dwaHorizon = 1.5;         // Rollout length (s)
+float dwaStep = 0.1;            // Rollout integration step (s)
+
+float dwaSafetyMargin = 0.05;   // Trajectories closer than this to an obstacle are rejected (m)
+float dwaClearanceCap = 1.0;    // Clearance beyond this scores the same (m)
+int dwaRayStride = 4;           // Use every n-th ray of the scan as an obstacle point
+
+float dwaHeadingWeight = 1.0;
+float dwaClearanceWeight = 0.6;
+float dwaVelocityWeight = 0.4;
+float dwaProgressWeight = 1.0;
+
+#pragma region Worker pool
+
+// Minimal parallel-for: the caller publishes a task, every worker and the caller pull chunks
+// of indices from a shared counter, and the caller returns once all chunks are done.
+class DwaWorkerPool{
+public:
+    void start(unsigned threads){
+        stop();
+        stopping = false;
+        for(unsigned i = 0; i < threads; i++){
+            workers.push_back(std::thread(&DwaWorkerPool::workerLoop, this, generation));
+        }
+    }
+
+    void stop(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(size_t i = 0; i < workers.size(); i++){
+            workers[i].join();
+        }
+        workers.clear();
+    }
+
+    void parallelFor(size_t count, const std::function<void(size_t)> &fn){
+        if(workers.empty()){
+            for(size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            taskCount = count;
+            next = 0;
+            pending = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        runChunks(fn, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]{ return pending == 0; });
+        task = nullptr;
+    }
+
+    ~DwaWorkerPool(){
+        stop();
+    }
+
+private:
+    static const size_t chunk = 8;
+
+    void runChunks(const std::function<void(size_t)> &fn, size_t count){
+        while(true){
+            size_t begin = next.fetch_add(chunk);
+            if(begin >= count) break;
+            size_t end = std::min(begin + chunk, count);
+            for(size_t i = begin; i < end; i++) fn(i);
+        }
+    }
+
+    void workerLoop(uint64_t seen){
+        while(true){
+            const std::function<void(size_t)> *fn;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]{ return stopping || generation != seen; });
+                if(stopping) return;
+                seen = generation;
+                fn = task;
+                count = taskCount;
+            }
+
+            runChunks(*fn, count);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--pending == 0) done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)> *task = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> next{0};
+    size_t pending = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+DwaWorkerPool dwaPool;
+
+#pragma endregion
+
+struct DwaSample{
+    float linear;
+    float angular;
+    float score;
+    float clearance;
+    bool valid;
+};
+
+std::vector<DwaSample> dwaSamples;
+
+void startDwaPlanner(unsigned threads){
+    // The calling thread also runs rollouts, so it counts towards the total
+    dwaPool.start(threads > 1 ? threads - 1 : 0);
+}
+
+void stopDwaPlanner(){
+    dwaPool.stop();
+}
+
+bool gatherScanObstacles(const ScanStruct &scan, DwaObstacles &obstacles){
+    obstacles.x.clear();
+    obstacles.y.clear();
+
+    for(size_t i = 0; i < scan.ranges.size(); i += dwaRayStride){
+        float range = scan.ranges[i];
+        if(!std::isfinite(range) || range < scan.rangeMin || range > scan.rangeMax) continue;
+
+        float angle = scan.angleMin + i * scan.angleIncrement;
+        obstacles.x.push_back(range * std::cos(angle));
+        obstacles.y.push_back(range * std::sin(angle));
+    }
+    return !obstacles.x.empty();
+}
+
+// Squared distance from (px, py) to the nearest obstacle point
+static float nearestObstacleSq(const DwaObstacles &obstacles, float px, float py){
+    const float *xs = obstacles.x.data();
+    const float *ys = obstacles.y.data();
+    size_t n = obstacles.x.size();
+
+    float best = std::numeric_limits<float>::max();
+    for(size_t i = 0; i < n; i++){
+        float dx = xs[i] - px;
+        float dy = ys[i] - py;
+        float d = dx * dx + dy * dy;
+        best = d < best ? d : best;
+    }
+    return best;
+}
+
+static void rolloutSample(const DwaObstacles &obstacles, float goalX, float goalY, const DwaLimits &limits, DwaSample &sample){
+    float x = 0, y = 0, theta = 0;
+    float minClearance = dwaClearanceCap;
+    int steps = std::max(1, (int) std::lround(dwaHorizon / dwaStep));
+
+    sample.valid = true;
+
+    for(int k = 0; k < steps; k++){
+        // Midpoint integration of the constant (v, w) arc
+        float midTheta = theta + 0.5f * sample.angular * dwaStep;
+        x += sample.linear * std::cos(midTheta) * dwaStep;
+        y += sample.linear * std::sin(midTheta) * dwaStep;
+        theta += sample.angular * dwaStep;
+
+        float clearance = std::sqrt(nearestObstacleSq(obstacles, x, y)) - robotRadius;
+        minClearance = std::min(minClearance, clearance);
+
+        if(minClearance < dwaSafetyMargin){
+            sample.valid = false;
+            sample.score = -std::numeric_limits<float>::max();
+            sample.clearance = minClearance;
+            return;
+        }
+    }
+
+    // Admissible only if the robot can still brake to a stop inside the clearance it found
+    if(sample.linear > std::sqrt(2 * limits.linearAccel * minClearance)){
+        sample.valid = false;
+        sample.score = -std::numeric_limits<float>::max();
+        sample.clearance = minClearance;
+        return;
+    }
+
+    float headingError = std::atan2(goalY - y, goalX - x) - theta;
+    while(headingError > M_PI) headingError -= 2 * M_PI;
+    while(headingError < -M_PI) headingError += 2 * M_PI;
+
+    float progress = std::hypot(goalX, goalY) - std::hypot(goalX - x, goalY - y);
+
+    sample.clearance = minClearance;
+    sample.score = dwaHeadingWeight * (1 - std::abs(headingError) / M_PI)
+                 + dwaClearanceWeight * minClearance / dwaClearanceCap
+                 + dwaVelocityWeight * sample.linear / std::max(limits.maxLinear, 1e-3f)
+                 + dwaProgressWeight * progress;
+}
+
+DwaCommand planDwa(const DwaObstacles &obstacles, float goalX, float goalY, float currentLinear, float currentAngular, const DwaLimits &limits){
+    // 1. Dynamic window: everything reachable from the current command within dwaWindowTime
+    float vLow = std::max(0.0f, currentLinear - limits.linearAccel * dwaWindowTime);
+    float vHigh = std::min(limits.maxLinear, currentLinear + limits.linearAccel * dwaWindowTime);
+    float wLow = std::max(-limits.maxAngular, currentAngular - limits.angularAccel * dwaWindowTime);
+    float wHigh = std::min(limits.maxAngular, currentAngular + limits.angularAccel * dwaWindowTime);
+    vHigh = std::max(vHigh, vLow);
+    wHigh = std::max(wHigh, wLow);
+
+    dwaSamples.resize(dwaLinearSamples * dwaAngularSamples);
+    for(int i = 0; i < dwaLinearSamples; i++){
+        for(int j = 0; j < dwaAngularSamples; j++){
+            DwaSample &sample = dwaSamples[i * dwaAngularSamples + j];
+            sample.linear = vLow + (vHigh - vLow) * i / std::max(1, dwaLinearSamples - 1);
+            sample.angular = wLow + (wHigh - wLow) * j / std::max(1, dwaAngularSamples - 1);
+        }
+    }
+
+    // 2. Roll out and score every sample in parallel
+    dwaPool.parallelFor(dwaSamples.size(), [&](size_t i){
+        rolloutSample(obstacles, goalX, goalY, limits, dwaSamples[i]);
+    });
+
+    // 3. Pick the best
+    DwaCommand best = {false, 0, 0, -std::numeric_limits<float>::max(), 0};
+    for(size_t i = 0; i < dwaSamples.size(); i++){
+        if(dwaSamples[i].valid && dwaSamples[i].score > best.score){
+            best.valid = true;
+            best.linear = dwaSamples[i].linear;
+            best.angular = dwaSamples[i].angular;
+            best.score = dwaSamples[i].score;
+            best.clearance = dwaSamples[i].clearance;
+        }
+    }
+    return best;
+}
+
+double benchmarkDwa(int iterations){
+    // Corridor 1.2 m wide with a wall 2.5 m ahead, sampled like a Kinect scan
+    DwaObstacles obstacles;
+    for(int i = 0; i < 160; i++){
+        float angle = Deg2Rad(-28.5 + 57.0 * i / 159);
+        float range = std::min(std::abs(0.6f / std::sin(angle + 1e-3f)), 2.5f / std::cos(angle));
+        obstacles.x.push_back(range * std::cos(angle));
+        obstacles.y.push_back(range * std::sin(angle));
+    }
+
+    DwaLimits limits = {0.6, (float) Deg2Rad(90.0), 0.5, 3.0};
+    float linear = 0.3;
+    float angular = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++){
+        DwaCommand cmd = planDwa(obstacles, 3.0, 0.5, linear, angular, limits);
+        if(cmd.valid){
+            linear = cmd.linear;
+            angular = cmd.angular;
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return (double) iterations * dwaLinearSamples * dwaAngularSamples / std::max(ms, 1e-6);
+}
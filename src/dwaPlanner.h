@@ -0,0 +1,47 @@
+#ifndef dwaPlannerHeader
+#define dwaPlannerHeader
+
+#include "common.h"
+
+#include <thread>
+
+// Dynamic Window Approach local planner. Each planning cycle samples (v, w) pairs reachable
+// within one window of the current command, rolls every pair forward as a constant-curvature
+// arc against the obstacle points and returns the best scoring command. Rollouts are spread
+// over a small worker pool started with startDwaPlanner().
+
+struct DwaObstacles{
+    std::vector<float> x;   // Robot frame (x forward, y left), structure-of-arrays for the inner loop
+    std::vector<float> y;
+};
+
+struct DwaLimits{
+    float maxLinear;        // m/s
+    float maxAngular;       // rad/s
+    float linearAccel;      // m/s^2
+    float angularAccel;     // rad/s^2
+};
+
+struct DwaCommand{
+    bool valid;             // False when every sampled trajectory collides
+    float linear;
+    float angular;
+    float score;
+    float clearance;        // Smallest clearance along the chosen trajectory (m)
+};
+
+void startDwaPlanner(unsigned threads = std::thread::hardware_concurrency());
+
+void stopDwaPlanner();
+
+extern float dwaHorizon;
+
+// Returns false when the scan has no usable return at all
+bool gatherScanObstacles(const ScanStruct &scan, DwaObstacles &obstacles);
+
+DwaCommand planDwa(const DwaObstacles &obstacles, float goalX, float goalY, float currentLinear, float currentAngular, const DwaLimits &limits);
+
+// Runs planDwa() on a synthetic corridor and returns the rollout throughput in rollouts per millisecond
+double benchmarkDwa(int iterations);
+
+#endif
@@ -0,0 +1,19 @@
+// Rollout throughput of the DWA planner: rosrun mie443_contest1 dwa_benchmark [iterations]
+#include "dwaPlanner.h"
+
+#include <cstdlib>
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned threads = 1; threads <= maxThreads; threads *= 2){
+        startDwaPlanner(threads);
+        double rate = benchmarkDwa(iterations);
+        printf("%2u thread(s): %8.1f rollouts/ms\n", threads, rate);
+        stopDwaPlanner();
+    }
+
+return 0;
+}
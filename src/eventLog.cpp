@@ -0,0 +1,189 @@
+#include "eventLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const uint32_t eventRingSize = 4096;            // Records per thread, a power of two
+const uint64_t eventFileCapacity = 1 << 21;     // Records, 64 MB
+const int eventDrainPeriodMs = 50;
+
+struct EventFormatEntry{
+    const char *name;
+    const char *format;
+};
+
+static const EventFormatEntry eventFormats[EV_COUNT] = {
+    {"handleBumperPressed2", "called, turn %.0f"},
+    {"handleBumperPressed2", "Reversing from (%.2f, %.2f)"},
+    {"handleBumperPressed2", "Turning %.0f from heading %.2f"},
+    {"handleBumperPressed2", "Advancing %.2f"},
+    {"handleBumperPressed2", "Correcting yaw at heading %.2f"},
+    {"handleBumperPressed2", "END at heading %.2f"},
+    {"navigateToPosition", "called with target (%.2f, %.2f)"},
+    {"navigateToPosition", "BUMPER HITS: %.0f at (%.2f, %.2f)"},
+    {"navigateToPosition", "reached (%.2f, %.2f)"},
+    {"wallFollow", "Detected corridor on the LEFT, change %.2f"},
+    {"wallFollow", "Detected corridor on the RIGHT, change %.2f"},
+    {"wallFollow", "front distance move %.2f"},
+    {"publishVelocity", "behavior %.0f reacted %.1f ms after the scan, %.1f ms after odometry"},
+    {"watchdogLoop", "topic %.0f out of budget, age %.3f s, rate %.1f Hz"},
+    {"watchdogLoop", "sensors back within budget"},
+    {"fireCancel", "motion cancelled, reason %.0f"},
+    {"clearCancel", "cancel reason %.0f cleared"},
+};
+
+const char *eventName(uint16_t id){
+    return id < EV_COUNT ? eventFormats[id].name : "unknown";
+}
+
+const char *eventFormat(uint16_t id){
+    return id < EV_COUNT ? eventFormats[id].format : "%g %g %g %g";
+}
+
+#pragma region Rings
+
+struct EventRing{
+    EventRecord records[eventRingSize];
+    std::atomic<uint32_t> head{0};      // Written by the owning thread
+    std::atomic<uint32_t> tail{0};      // Written by the writer thread
+    uint32_t sequence = 0;
+    uint16_t thread = 0;
+};
+
+static std::atomic<bool> eventLogRunning{false};
+static std::atomic<uint64_t> eventsDropped{0};
+static std::mutex ringsMutex;
+static std::vector<EventRing *> rings;
+static thread_local EventRing *threadRing = nullptr;
+
+static EventRing *registerRing(){
+    EventRing *ring = new EventRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring->thread = (uint16_t) rings.size();
+    rings.push_back(ring);
+    return ring;
+}
+
+void logEvent(EventId id, float a, float b, float c, float d){
+    if(!eventLogRunning.load(std::memory_order_relaxed)){
+        return;
+    }
+    if(threadRing == nullptr){
+        threadRing = registerRing();
+    }
+
+    EventRing &ring = *threadRing;
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    uint32_t sequence = ring.sequence++;
+    if(head - ring.tail.load(std::memory_order_acquire) >= eventRingSize){
+        eventsDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    EventRecord &record = ring.records[head & (eventRingSize - 1)];
+    record.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    record.id = id;
+    record.thread = ring.thread;
+    record.sequence = sequence;
+    record.args[0] = a;
+    record.args[1] = b;
+    record.args[2] = c;
+    record.args[3] = d;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+#pragma endregion
+
+#pragma region Writer
+
+static int eventFile = -1;
+static EventLogHeader *eventHeader = nullptr;
+static EventRecord *eventRecords = nullptr;
+static size_t eventMappedBytes = 0;
+static std::thread eventWriter;
+
+static void drainRings(){
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for(EventRing *ring : rings){
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+
+        for(; tail != head; tail++){
+            if(eventHeader->records >= eventFileCapacity){
+                eventsDropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            eventRecords[eventHeader->records++] = ring->records[tail & (eventRingSize - 1)];
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    eventHeader->dropped = eventsDropped.load(std::memory_order_relaxed);
+}
+
+static void eventWriterLoop(){
+    while(eventLogRunning.load(std::memory_order_relaxed)){
+        drainRings();
+        std::this_thread::sleep_for(std::chrono::milliseconds(eventDrainPeriodMs));
+    }
+}
+
+bool startEventLog(const char *path){
+    if(eventLogRunning) return true;
+
+    eventFile = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(eventFile < 0){
+        std::perror("startEventLog() | open");
+        return false;
+    }
+
+    eventMappedBytes = sizeof(EventLogHeader) + eventFileCapacity * sizeof(EventRecord);
+    void *mapping = MAP_FAILED;
+    if(ftruncate(eventFile, eventMappedBytes) == 0){
+        mapping = mmap(nullptr, eventMappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, eventFile, 0);
+    }
+    if(mapping == MAP_FAILED){
+        std::perror("startEventLog() | mmap");
+        close(eventFile);
+        eventFile = -1;
+        return false;
+    }
+
+    eventHeader = (EventLogHeader *) mapping;
+    eventRecords = (EventRecord *) ((char *) mapping + sizeof(EventLogHeader));
+    std::memcpy(eventHeader->magic, "MIE443EV", 8);
+    eventHeader->version = 1;
+    eventHeader->recordSize = sizeof(EventRecord);
+    eventHeader->records = 0;
+    eventHeader->dropped = 0;
+
+    eventLogRunning = true;
+    eventWriter = std::thread(eventWriterLoop);
+    return true;
+}
+
+void stopEventLog(){
+    if(!eventLogRunning) return;
+    eventLogRunning = false;
+    if(eventWriter.joinable()) eventWriter.join();
+
+    drainRings();
+    size_t used = sizeof(EventLogHeader) + eventHeader->records * sizeof(EventRecord);
+    munmap(eventHeader, eventMappedBytes);
+    if(ftruncate(eventFile, used) != 0){
+        std::perror("stopEventLog() | ftruncate");
+    }
+    close(eventFile);
+    eventFile = -1;
+    eventHeader = nullptr;
+    eventRecords = nullptr;
+}
+
+#pragma endregion
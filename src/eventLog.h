@@ -0,0 +1,60 @@
+#ifndef eventLogHeader
+#define eventLogHeader
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary event log for the hot loops. logEvent() copies a 32 byte record into a single-producer
+// ring owned by the calling thread and returns; no formatting, locking or I/O happens on the
+// control path. A writer thread drains every ring into a memory-mapped file, which
+// `rosrun mie443_contest1 event_decode <file>` turns back into text.
+
+enum EventId : uint16_t {
+    EV_BUMPER_RECOVERY_START,
+    EV_BUMPER_REVERSING,
+    EV_BUMPER_TURNING,
+    EV_BUMPER_ADVANCING,
+    EV_BUMPER_CORRECTING,
+    EV_BUMPER_RECOVERY_END,
+    EV_NAVIGATE_START,
+    EV_NAVIGATE_BUMPER_HIT,
+    EV_NAVIGATE_END,
+    EV_CORRIDOR_LEFT,
+    EV_CORRIDOR_RIGHT,
+    EV_CORRIDOR_ADVANCE,
+    EV_COMMAND_LATENCY,
+    EV_WATCHDOG_BREACH,
+    EV_WATCHDOG_RESUME,
+    EV_CANCEL_FIRED,
+    EV_CANCEL_CLEARED,
+    EV_COUNT
+};
+
+struct EventRecord{
+    uint64_t timeNs;    // steady clock
+    uint16_t id;        // EventId
+    uint16_t thread;    // Order in which the logging thread first logged
+    uint32_t sequence;  // Per-thread, gaps mean records were dropped
+    float args[4];
+};
+
+struct EventLogHeader{
+    char magic[8];      // "MIE443EV"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t records;   // Records written so far, kept current while running
+    uint64_t dropped;   // Records lost to full rings or a full file
+};
+
+// printf format for each event's arguments, used by the decoder
+const char *eventName(uint16_t id);
+const char *eventFormat(uint16_t id);
+
+bool startEventLog(const char *path);
+
+// Drains what is left and trims the file
+void stopEventLog();
+
+void logEvent(EventId id, float a = 0, float b = 0, float c = 0, float d = 0);
+
+#endif
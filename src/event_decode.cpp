@@ -0,0 +1,50 @@
+// Prints a binary event log written by contest1 as text, one record per line, in time order.
+// Usage: rosrun mie443_contest1 event_decode contest1_events.bin
+
+#include "eventLog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        std::fprintf(stderr, "usage: %s <event log>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = std::fopen(argv[1], "rb");
+    if(!file){
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    EventLogHeader header;
+    if(std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, "MIE443EV", 8) != 0
+        || header.recordSize != sizeof(EventRecord)){
+        std::fprintf(stderr, "%s: not an event log of this version\n", argv[1]);
+        std::fclose(file);
+        return 1;
+    }
+
+    // A crashed run leaves the full preallocated file; the header says how much of it is valid
+    std::vector<EventRecord> records(header.records);
+    size_t read = std::fread(records.data(), sizeof(EventRecord), records.size(), file);
+    std::fclose(file);
+    records.resize(read);
+
+    // Each thread's records are in order already; the writer interleaves threads by drain
+    std::stable_sort(records.begin(), records.end(), [](const EventRecord &a, const EventRecord &b){
+        return a.timeNs < b.timeNs;
+    });
+
+    uint64_t start = records.empty() ? 0 : records.front().timeNs;
+    char text[256];
+    for(const EventRecord &record : records){
+        std::snprintf(text, sizeof(text), eventFormat(record.id), record.args[0], record.args[1], record.args[2], record.args[3]);
+        std::printf("%12.6f [%u:%u] %s() | %s\n", (record.timeNs - start) * 1e-9, record.thread, record.sequence, eventName(record.id), text);
+    }
+    std::fprintf(stderr, "%zu records, %llu dropped\n", records.size(), (unsigned long long) header.dropped);
+    return 0;
+}
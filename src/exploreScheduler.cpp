@@ -0,0 +1,145 @@
+#include "exploreScheduler.h"
+#include "distanceField.h"
+#include "clock.h"
+
+float schedulerSensingRange = 3.0;  // m, radius a sweep maps out to
+float sweepSettleTime = 1.0;        // s added to every sweep for starting and stopping
+float sweepYieldPrior = 0.3;        // Share of the uncovered fan a sweep adds to the map, most is already known
+float travelGainPrior = 6.0;        // m^2 mapped per trip before any trip is measured
+float travelTimePrior = 10.0;       // s per trip, recoveries excluded
+float recoveryTimePrior = 6.0;      // s per bumper recovery
+float recoveriesPerTripPrior = 0.2;
+float estimateSmoothing = 0.3;      // Weight of the newest measurement
+double wallFollowWindow = 20.0;     // s over which the wall following rate is measured
+extern float sweepAngular;          // rad/s (biasedExplore.cpp)
+
+static double budgetStart = -1;
+static double budget = 0;
+
+static float sweepYield = sweepYieldPrior;     // Observed / predicted sweep gain
+static float predictedSweepGain = 0;
+static float travelGain = travelGainPrior;
+static float travelTime = travelTimePrior;
+static float recoveryTime = recoveryTimePrior;
+static float recoveriesPerTrip = recoveriesPerTripPrior;
+
+static double actionStart = 0;
+static float actionStartArea = 0;
+static int tripRecoveries = 0;
+static double tripRecoveryTime = 0;
+
+static double windowStart = -1;
+static float windowArea = 0;
+
+static float smooth(float estimate, float sample){
+    return (1 - estimateSmoothing) * estimate + estimateSmoothing * sample;
+}
+
+static float travelCost(){
+    return travelTime + recoveriesPerTrip * recoveryTime;
+}
+
+void startExploreScheduler(double budgetSeconds){
+    budgetStart = clockNow();
+    budget = budgetSeconds;
+}
+
+double remainingBudget(){
+    if(budgetStart < 0){
+        return budget > 0 ? budget : 1e9;
+    }
+    return std::max(0.0, budget - (clockNow() - budgetStart));
+}
+
+ExploreAction chooseExploreAction(float sweepTurnDeg, float halfFovDeg){
+    if(sweepTurnDeg <= 0){
+        predictedSweepGain = 0;
+        return ACTION_TRAVEL;
+    }
+    double remaining = remainingBudget();
+
+    // Both rates are per second actually spent, so a sweep cut short keeps its rate while an
+    // unfinished trip earns only a small share of its gain
+    float sweepCost = sweepTurnDeg / Rad2Deg(sweepAngular) + sweepSettleTime;
+    float sweepFan = std::min(360.0f, sweepTurnDeg + 2 * halfFovDeg);
+    float sweepGain = sweepYield * sweepFan / 360 * M_PI * schedulerSensingRange * schedulerSensingRange;
+    float sweepRate = sweepGain / sweepCost;
+
+    float tripCost = travelCost();
+    float completed = std::min(1.0, remaining / tripCost);
+    float travelRate = travelGain * completed * completed / std::min((double) tripCost, std::max(remaining, 1e-3));
+
+    ExploreAction choice = sweepRate > travelRate ? ACTION_SWEEP : ACTION_TRAVEL;
+    // Only the sweep chosen here is learned from, a fallback sweep after a travel choice is not
+    predictedSweepGain = choice == ACTION_SWEEP ? sweepGain * std::min(1.0f, sweepTurnLimit() / sweepTurnDeg) : 0;
+    ROS_INFO("chooseExploreAction() | %.0f s left, sweep %.2f m^2/s over %.0f s, travel %.2f m^2/s over %.0f s: %s",
+        remaining, sweepRate, sweepCost, travelRate, tripCost, choice == ACTION_SWEEP ? "sweep" : "travel");
+    return choice;
+}
+
+float sweepTurnLimit(){
+    return std::max(0.0, remainingBudget() - sweepSettleTime) * Rad2Deg(sweepAngular);
+}
+
+bool leaveWallFollowing(){
+    if(remainingBudget() < wallFollowWindow){
+        return true;
+    }
+
+    double now = clockNow();
+    float area = mappedArea();
+    if(windowStart < 0 || area <= 0){
+        windowStart = now;
+        windowArea = area;
+        return false;
+    }
+    if(now - windowStart < wallFollowWindow){
+        return false;
+    }
+
+    float rate = (area - windowArea) / (now - windowStart);
+    windowStart = now;
+    windowArea = area;
+
+    float travelRate = travelGain / travelCost();
+    if(rate < travelRate){
+        ROS_INFO("leaveWallFollowing() | wall following maps %.2f m^2/s, travel is expected to map %.2f m^2/s", rate, travelRate);
+        return true;
+    }
+    return false;
+}
+
+void beginExploreAction(ExploreAction action){
+    actionStart = clockNow();
+    actionStartArea = mappedArea();
+    tripRecoveries = 0;
+    tripRecoveryTime = 0;
+}
+
+void endExploreAction(ExploreAction action){
+    double elapsed = clockNow() - actionStart;
+    if(elapsed <= 0){
+        return;
+    }
+    // gmapping publishes a few seconds behind, part of an action's gain lands on the next one.
+    // The smoothing evens that out.
+    float gain = std::max(0.0f, mappedArea() - actionStartArea);
+
+    if(action == ACTION_SWEEP){
+        if(predictedSweepGain > 0){
+            sweepYield = smooth(sweepYield, std::max(0.1f, std::min(3.0f, gain / predictedSweepGain)));
+        }
+        predictedSweepGain = 0;     // Each prediction is for the sweep chosen right after it
+    }
+    else {
+        travelGain = smooth(travelGain, gain);
+        travelTime = smooth(travelTime, std::max(0.0, elapsed - tripRecoveryTime));
+        recoveriesPerTrip = smooth(recoveriesPerTrip, tripRecoveries);
+    }
+}
+
+void noteRecovery(double seconds){
+    tripRecoveries++;
+    tripRecoveryTime += seconds;
+    recoveryTime = smooth(recoveryTime, seconds);
+}
@@ -0,0 +1,40 @@
+#ifndef exploreSchedulerHeader
+#define exploreSchedulerHeader
+
+#include "common.h"
+
+// Spends the contest clock on whatever is expected to map the most new area per second. Each
+// action's cost and yield are learned online from the gmapping area (mappedArea()) gained while
+// it ran, starting from priors:
+//  - sweep: turning to cover stale bearings, gain predicted from the uncovered fan and scaled by
+//    the observed/predicted ratio of past sweeps, cost from the turn at sweepAngular,
+//  - travel: driving to the next candidate, average gain and driving time of past trips,
+//  - recovery: bumper recoveries per trip times their average duration, charged to travel.
+// A sweep maps in proportion to how far it turns, so it is cut down to what fits in the time
+// left. A trip mostly pays off on arrival, so one that cannot finish is worth little and near
+// the end the scheduler favours sweeps and short trips.
+
+enum ExploreAction {ACTION_SWEEP, ACTION_TRAVEL};
+
+void startExploreScheduler(double budgetSeconds);
+
+double remainingBudget();
+
+// Sweep or travel, given the turn (degrees) a sweep would need from here
+ExploreAction chooseExploreAction(float sweepTurnDeg, float halfFovDeg);
+
+// Largest turn (degrees) a sweep may make in the time left
+float sweepTurnLimit();
+
+// True once wall following has mapped less per second over the last window than travelling
+// is expected to, or too little time is left to finish the loop
+bool leaveWallFollowing();
+
+// Bracket each action so its cost and gain are measured and not charged to the next one. A
+// sweep that chooseExploreAction() did not pick, like the fallback full sweep, is not learned from.
+void beginExploreAction(ExploreAction action);
+void endExploreAction(ExploreAction action);
+
+void noteRecovery(double seconds);
+
+#endif
@@ -0,0 +1,119 @@
+#include "joystick.h"
+#include "cancelToken.h"
+#include "commandArbiter.h"
+#include "speedGovernor.h"
+#include "replay.h"
+
+#include <ros/callback_queue.h>
+
+#include <memory>
+
+float sharedControlAuthority = 0.7;    // Operator weight at full stick deflection
+float joystickDeadband = 0.1;           // Deflection fraction treated as a centred stick
+float joystickMaxLinear = 0.2;          // m/s at full stick, teleController's scaling
+float joystickMaxAngular = 1.2;         // rad/s at full stick
+double teleopLifetime = 0.25;           // s a shared control command stays valid, refreshed at arbiterRate
+
+teleController joystick;
+
+static ros::CallbackQueue joyQueue;
+static ros::Subscriber joySub;
+static std::unique_ptr<ros::AsyncSpinner> joySpinner;
+static ros::Timer teleopTimer;
+
+static void joyCallback(const sensor_msgs::Joy::ConstPtr& msg){
+    bool wasStopped = joystick.getState();
+    bool wasShared = joystick.getTeleop();
+    joystick.controllerCallback(msg);
+    bool stopped = joystick.getState();
+
+    if(joystick.getTeleop() != wasShared){
+        ROS_INFO("joyCallback() | shared control %s", wasShared ? "off" : "on");
+    }
+
+    if(stopped && !wasStopped){
+        ROS_WARN("joyCallback() | e-stop pressed");
+        fireCancel(motionCancel, CANCEL_ESTOP);
+    }
+    else if(!stopped && wasStopped){
+        ROS_INFO("joyCallback() | e-stop released");
+        clearCancel(motionCancel, CANCEL_ESTOP);
+    }
+}
+
+struct JoystickInput{
+    uint8_t teleop;
+    float linear;
+    float angular;
+};
+
+// Operator weight for a stick position, 0 inside the deadband
+static float stickWeight(float stickLinear, float stickAngular){
+    float deflection = std::max(std::abs(stickLinear) / joystickMaxLinear, std::abs(stickAngular) / joystickMaxAngular);
+    if(deflection < joystickDeadband){
+        return 0;
+    }
+    return sharedControlAuthority * std::min(deflection, 1.0f);
+}
+
+bool blendJoystick(Behavior behavior, float &linear, float &angular){
+    // Written by the joystick thread, so a recorded input
+    JoystickInput stick = {0, 0, 0};
+    if(!replayInput(REPLAY_JOYSTICK, &stick, sizeof(stick))){
+        stick = {joystick.getTeleop(), (float) joystick.getLinear(), (float) joystick.getAngular()};
+        recordInput(REPLAY_JOYSTICK, &stick, sizeof(stick));
+    }
+
+    // Recoveries run to completion, the operator can steer again once they hand back
+    if(!stick.teleop || behavior == BEHAVIOR_BUMPER_RECOVERY){
+        return false;
+    }
+
+    float weight = stickWeight(stick.linear, stick.angular);
+    if(weight <= 0){
+        return false;
+    }
+    linear = (1 - weight) * linear + weight * stick.linear;
+    angular = (1 - weight) * angular + weight * stick.angular;
+    return true;
+}
+
+// Runs on the joystick thread. Autonomous sources outrank it, so this only drives while none is.
+// The arbiter publishes it unprofiled, so forward speed is capped at the control thread's last
+// governed limit.
+static void submitTeleop(const ros::TimerEvent &){
+    float stickLinear = joystick.getLinear();
+    float stickAngular = joystick.getAngular();
+    float weight = joystick.getTeleop() && !joystick.getState() ? stickWeight(stickLinear, stickAngular) : 0;
+    if(weight <= 0){
+        cancelCommand(SOURCE_TELEOP);
+        return;
+    }
+
+    geometry_msgs::Twist twist;
+    twist.linear.x = std::min(weight * stickLinear, governedForwardSnapshot());
+    twist.angular.z = weight * stickAngular;
+    submitCommand(SOURCE_TELEOP, twist, teleopLifetime, {0, 0, BEHAVIOR_OTHER});
+}
+
+void startJoystick(ros::NodeHandle &nh){
+    ros::NodeHandle joyNh(nh);
+    joyNh.setCallbackQueue(&joyQueue);
+    joySub = joyNh.subscribe("joy", 10, &joyCallback);
+
+    // The joystick driver only publishes on change, so a held stick is resubmitted on a timer
+    teleopTimer = joyNh.createTimer(ros::Duration(1.0 / arbiterRate), &submitTeleop);
+
+    joySpinner.reset(new ros::AsyncSpinner(1, &joyQueue));
+    joySpinner->start();
+}
+
+void stopJoystick(){
+    if(joySpinner){
+        joySpinner->stop();
+        joySpinner.reset();
+    }
+    teleopTimer.stop();
+    cancelCommand(SOURCE_TELEOP);
+    joySub.shutdown();
+}
@@ -0,0 +1,31 @@
+#ifndef joystickHeader
+#define joystickHeader
+
+#include "common.h"
+#include "commandTrace.h"
+#include <eStop.h>
+
+// Joystick input on its own callback queue and spinner thread, so the e-stop still fires while
+// the control thread is blocked inside a motion primitive. Pressing the e-stop fires
+// CANCEL_ESTOP on motionCancel and releasing it clears it again.
+
+extern teleController joystick;
+
+void startJoystick(ros::NodeHandle &nh);
+
+void stopJoystick();
+
+// Shared control: while teleop is toggled on, each control tick mixes the stick into the
+// autonomous setpoint with a weight that grows with stick deflection, up to
+// sharedControlAuthority. A centred stick leaves autonomy untouched. publishVelocity() applies
+// this before the speed governor, so the blended command is still clearance-limited; the
+// zero that stopVelocity() sends to end a motion is never blended. Returns true if the stick
+// changed the command.
+// While no autonomous source is commanding (planning, between primitives) the joystick thread
+// submits the same blend against a zero setpoint at SOURCE_TELEOP, the lowest priority, so the
+// operator can still steer then.
+extern float sharedControlAuthority;
+
+bool blendJoystick(Behavior behavior, float &linear, float &angular);
+
+#endif
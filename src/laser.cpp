@@ -1,13 +1,29 @@
 #include "laser.h"
+#include "candidateBuffer.h"
+#include "obstacleMemory.h"
+#include "metrics.h"
+#include "commandTrace.h"
 
 uint16_t nLasers;
 float fullAngle = 57.0;
 
 DistancesStruct distances;
+ScanStruct scan;
 
 
 void laserCallback(const sensor_msgs::LaserScan::ConstPtr& msg){
+    ScopedMetric probe(METRIC_LASER_CALLBACK);
+    scanReceivedTicks = metricNow();
+    noteScanStamp(msg->header.stamp.toSec());
     nLasers = (msg->angle_max - msg->angle_min) / msg->angle_increment;
+
+    // 0. Keep the full scan for controllers that need more than the three rays
+    scan.ranges.assign(msg->ranges.begin(), msg->ranges.end());
+    scan.angleMin = msg->angle_min;
+    scan.angleIncrement = msg->angle_increment;
+    scan.rangeMin = msg->range_min;
+    scan.rangeMax = msg->range_max;
+
     // 1. Update previous values
     distances.leftRayPrev = distances.leftRay;
     distances.leftHorzPrev = distances.leftHorz;
@@ -57,11 +73,12 @@ void laserCallback(const sensor_msgs::LaserScan::ConstPtr& msg){
         }
     }
 
-    // 3c Front
+    // 3c Front, searching outwards from the centre. With no finite return anywhere, which is
+    //    what the Kinect reports when it is pressed against something, it stays NaN.
     int i = 1;
     bool odd = true;
 
-    while(std::isnan(distances.frontRay)){
+    while(std::isnan(distances.frontRay) && std::abs(i) <= frontInd){
         distances.frontRay = msg->ranges[frontInd+i];
         if(odd){
             odd = false;
@@ -85,6 +102,12 @@ void laserCallback(const sensor_msgs::LaserScan::ConstPtr& msg){
     // 5. Calculate min Distance
     distances.min = std::min(std::min(distances.rightRay, distances.frontRay), distances.leftRay);
 
+    // 6. Harvest exploration candidates from the whole fan while driving
+    observeScanCandidates(scan, posX, posY, yaw, msg->header.stamp.toSec());
+
+    // 7. Remember nearby obstacles for when they leave the fan
+    observeScanObstacles(scan, posX, posY, yaw, msg->header.stamp.toSec());
+
 
 }
 
@@ -0,0 +1,152 @@
+#include "metrics.h"
+
+#include <std_msgs/Float32MultiArray.h>
+
+#ifdef METRIC_TSC
+#include <cpuid.h>
+#endif
+
+float metricsPublishRate = 1;   // Hz
+double tscCalibrationTime = 0.005;  // s of steady_clock the TSC rate is measured over at startup
+
+LatencyHistogram metricHistograms[METRIC_COUNT];
+std::atomic<uint64_t> scanReceivedTicks{0};
+std::atomic<uint64_t> odomReceivedTicks{0};
+
+static const char *metricNames[METRIC_COUNT] = {
+    "laserCallback", "odomCallback", "findNextDestination", "planDwa",
+    "wallFollowTick", "scanAge", "odomAge", "loopJitter",
+    "scanToCmdOther", "scanToCmdWallFollow", "scanToCmdNavigation", "scanToCmdBumper"
+};
+
+bool metricUseTsc = false;
+double metricNsPerTick = 1;
+
+#ifdef METRIC_TSC
+static bool invariantTsc(){
+    unsigned eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007){
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1u << 8);
+}
+#endif
+
+// Runs before main(), so every probe sees the final clock
+static bool calibrateMetricClock(){
+#ifdef METRIC_TSC
+    if(!invariantTsc()){
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTicks = __rdtsc();
+    auto end = start;
+    while(std::chrono::duration<double>(end - start).count() < tscCalibrationTime){
+        end = std::chrono::steady_clock::now();
+    }
+    uint64_t ticks = __rdtsc() - startTicks;
+    metricNsPerTick = std::chrono::duration<double, std::nano>(end - start).count() / ticks;
+    metricUseTsc = true;
+#endif
+    return metricUseTsc;
+}
+
+static bool metricClockCalibrated = calibrateMetricClock();
+
+static ros::Publisher metrics_pub;
+static std::thread metricsThread;
+static std::atomic<bool> metricsRunning{false};
+
+struct MetricSummary{
+    uint64_t count;
+    double meanUs;
+    double p50Us;
+    double p90Us;
+    double p99Us;
+    double maxUs;
+};
+
+// Upper edge of a bucket in ticks, the conservative value to report for it
+static uint64_t bucketUpper(int bucket){
+    if(bucket < metricSubBuckets) return bucket;
+    int exponent = bucket / metricSubBuckets + 2;
+    int sub = bucket % metricSubBuckets;
+    return ((uint64_t) (metricSubBuckets + sub + 1) << (exponent - 3)) - 1;
+}
+
+static MetricSummary summarize(MetricId id){
+    LatencyHistogram &h = metricHistograms[id];
+    uint64_t counts[metricBuckets];
+    uint64_t count = 0;
+    for(int b = 0; b < metricBuckets; b++){
+        counts[b] = h.counts[b].load(std::memory_order_relaxed);
+        count += counts[b];
+    }
+
+    MetricSummary summary = {count, 0, 0, 0, 0, 0};
+    if(count == 0) return summary;
+
+    // The only place ticks become time
+    double usPerTick = metricNsPerTick * 1e-3;
+    summary.meanUs = h.sumTicks.load(std::memory_order_relaxed) * usPerTick / count;
+    summary.maxUs = h.maxTicks.load(std::memory_order_relaxed) * usPerTick;
+
+    const double quantiles[3] = {0.5, 0.9, 0.99};
+    double *outputs[3] = {&summary.p50Us, &summary.p90Us, &summary.p99Us};
+    uint64_t seen = 0;
+    int q = 0;
+    for(int b = 0; b < metricBuckets && q < 3; b++){
+        seen += counts[b];
+        while(q < 3 && seen >= quantiles[q] * count){
+            *outputs[q] = std::min(bucketUpper(b) * usPerTick, summary.maxUs);
+            q++;
+        }
+    }
+    return summary;
+}
+
+static void publishMetrics(){
+    // One row per metric: count, mean, p50, p90, p99, max (microseconds)
+    std_msgs::Float32MultiArray msg;
+    for(int m = 0; m < METRIC_COUNT; m++){
+        MetricSummary s = summarize((MetricId) m);
+        float row[6] = {(float) s.count, (float) s.meanUs, (float) s.p50Us, (float) s.p90Us, (float) s.p99Us, (float) s.maxUs};
+        msg.data.insert(msg.data.end(), row, row + 6);
+    }
+    metrics_pub.publish(msg);
+}
+
+static void metricsLoop(){
+    ros::Rate rate(metricsPublishRate);
+    while(metricsRunning && ros::ok()){
+        if(metrics_pub.getNumSubscribers() > 0){
+            publishMetrics();
+        }
+        rate.sleep();
+    }
+}
+
+void startMetrics(ros::NodeHandle &nh){
+    if(metricsRunning) return;
+    metrics_pub = nh.advertise<std_msgs::Float32MultiArray>("contest1/metrics", 1);
+    if(metricClockCalibrated){
+        ROS_INFO("startMetrics() | probes read the TSC at %.3f ns per tick", metricNsPerTick);
+    }
+    metricsRunning = true;
+    metricsThread = std::thread(metricsLoop);
+}
+
+void stopMetrics(){
+    metricsRunning = false;
+    if(metricsThread.joinable()) metricsThread.join();
+}
+
+void dumpMetrics(){
+    std::printf("%-20s %10s %10s %10s %10s %10s %10s  (us)\n", "metric", "count", "mean", "p50", "p90", "p99", "max");
+    for(int m = 0; m < METRIC_COUNT; m++){
+        MetricSummary s = summarize((MetricId) m);
+        std::printf("%-20s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", metricNames[m], (unsigned long long) s.count,
+            s.meanUs, s.p50Us, s.p90Us, s.p99Us, s.maxUs);
+    }
+}
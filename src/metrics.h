@@ -0,0 +1,113 @@
+#ifndef metricsHeader
+#define metricsHeader
+
+#include "common.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define METRIC_TSC
+#endif
+
+// Runtime latency metrics. Each metric is a log-linear (HDR-style) histogram of probe clock
+// ticks: 8 linear sub-buckets per power of two, so any recorded value is known to within 12.5%.
+// Ticks are scaled to time only when a histogram is summarized, so a probe is two clock reads
+// plus a few nanoseconds and can be left on in contest runs; see metricNow() for the clock.
+// Each metric has a single writer, so recording is plain relaxed atomic loads and stores with
+// no read-modify-write, and the publisher thread can read at any time without locking.
+// The probes are recorded on the control thread, which also runs the processing callbacks. The
+// scan-to-command metrics are recorded by the thread that publishes commands: the arbiter thread
+// while it runs, and the control thread before it starts or after it has joined. A publisher
+// thread sends snapshots on contest1/metrics and dumpMetrics() prints them at shutdown.
+
+enum MetricId {
+    METRIC_LASER_CALLBACK,      // Duration of laserCallback
+    METRIC_ODOM_CALLBACK,       // Duration of odomCallback
+    METRIC_FIND_DESTINATION,    // Duration of the grid findNextDestination
+    METRIC_DWA_PLAN,            // Duration of one planDwa cycle
+    METRIC_WALL_FOLLOW_TICK,    // Duration of one WALL_FOLLOW iteration of the main loop
+    METRIC_SCAN_AGE,            // Time from laserCallback to a controller acting on the scan
+    METRIC_ODOM_AGE,            // Time from odomCallback to a controller acting on the pose
+    METRIC_LOOP_JITTER,         // Deviation of the main loop period from its nominal rate
+    METRIC_SCAN_TO_CMD_OTHER,               // Scan header.stamp to the first command reacting to it,
+    METRIC_SCAN_TO_CMD_WALL_FOLLOWING,      // per behavior (see commandTrace.h)
+    METRIC_SCAN_TO_CMD_NAVIGATION,
+    METRIC_SCAN_TO_CMD_BUMPER_RECOVERY,
+    METRIC_COUNT
+};
+
+const int metricSubBuckets = 8;
+const int metricBuckets = 64 * metricSubBuckets;
+
+struct LatencyHistogram{
+    std::atomic<uint64_t> counts[metricBuckets];
+    std::atomic<uint64_t> sumTicks;
+    std::atomic<uint64_t> maxTicks;
+};
+
+extern LatencyHistogram metricHistograms[METRIC_COUNT];
+
+// Probe clock. With an invariant TSC a read is one rdtsc, a few ns against 20-50 ns for
+// steady_clock; metricNsPerTick is its rate, measured against steady_clock at startup.
+// Elsewhere, or if the CPU does not report the TSC as invariant, it is steady_clock in ns.
+extern bool metricUseTsc;
+extern double metricNsPerTick;
+
+inline uint64_t metricNow(){
+#ifdef METRIC_TSC
+    if(metricUseTsc){
+        return __rdtsc();
+    }
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int metricBucket(uint64_t ticks){
+    if(ticks < metricSubBuckets) return (int) ticks;
+    int exponent = 63 - __builtin_clzll(ticks);         // >= 3
+    int sub = (int) (ticks >> (exponent - 3)) & (metricSubBuckets - 1);
+    return (exponent - 2) * metricSubBuckets + sub;
+}
+
+// Single writer per metric at any time, see above
+inline void recordMetric(MetricId id, uint64_t ticks){
+    LatencyHistogram &h = metricHistograms[id];
+    std::atomic<uint64_t> &count = h.counts[metricBucket(ticks)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h.sumTicks.store(h.sumTicks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+    if(ticks > h.maxTicks.load(std::memory_order_relaxed)){
+        h.maxTicks.store(ticks, std::memory_order_relaxed);
+    }
+}
+
+// For durations measured on another clock, off the probe path
+inline void recordMetricNs(MetricId id, uint64_t ns){
+    recordMetric(id, (uint64_t) (ns / metricNsPerTick));
+}
+
+// Age of data stamped with metricNow() when it arrived
+inline void recordDataAge(MetricId id, uint64_t receivedTicks){
+    if(receivedTicks != 0) recordMetric(id, metricNow() - receivedTicks);
+}
+
+// Records the lifetime of the enclosing scope
+struct ScopedMetric{
+    explicit ScopedMetric(MetricId id) : id(id), start(metricNow()) {}
+    ~ScopedMetric(){ recordMetric(id, metricNow() - start); }
+    MetricId id;
+    uint64_t start;
+};
+
+// Probe clock reads when the latest sensor data was processed, for the age metrics
+extern std::atomic<uint64_t> scanReceivedTicks;
+extern std::atomic<uint64_t> odomReceivedTicks;
+
+void startMetrics(ros::NodeHandle &nh);
+
+void stopMetrics();
+
+// Prints every metric with its count, mean, p50, p90, p99 and max
+void dumpMetrics();
+
+#endif
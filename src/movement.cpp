@@ -13,6 +13,23 @@ float kn_n = 0.5;
 float minLinear = 0.1;
 float maxLinear = 0.6;
 
+float dwaPlanRate = 20;         // Hz
+float contactObstacleRange = 2.0;   // Bumper marks within this distance are passed to the planner (m)
+float memoryObstacleRange = 1.5;    // Remembered points within this distance are passed to the planner (m)
+int navigationBumperHitsLimit = 3;  // Bumper hits before a target is given up
+float navigationProgressDistance = 0.15;    // Closer than the best so far by this much counts as progress (m)
+double navigationProgressTimeout = 10;      // Target given up after this long without progress (s)
+
+float pathTrackRate = 20;       // Hz
+float lookaheadMin = 0.35;      // m
+float lookaheadMax = 1.2;       // m
+float lookaheadGain = 1.0;      // Extra lookahead per m/s of speed (s)
+
+float turnTolerance = 1.0;      // Degrees
+float turnMinAngular = 8;       // Degrees per second, floor so the last few degrees still complete
+float turnMaxAngular = 90;      // Degrees per second
+float turnAngularAccel = 180;   // Degrees per second squared
+
 float linear;
 float angular;
 
@@ -20,9 +37,14 @@ float posX, posY, yaw;
 
 
 void odomCallback(const nav_msgs::Odometry::ConstPtr& msg){
+    ScopedMetric probe(METRIC_ODOM_CALLBACK);
+    odomReceivedTicks = metricNow();
+    noteOdomStamp(msg->header.stamp.toSec());
     posX = msg->pose.pose.position.x;
     posY = msg->pose.pose.position.y;
     yaw = Rad2Deg(tf::getYaw(msg->pose.pose.orientation));
+    refreshObstacleSectors(posX, posY, yaw, msg->header.stamp.toSec());
+    applyCachedOdomToMap();
     //ROS_INFO("Position: (%f, %f) Orientation: %f rad or %f degrees.", posX, posY, yaw, Rad2Deg(yaw));
 }
 
@@ -58,9 +80,12 @@ float computeLinear(float tgtX, float tgtY, float posX, float posY){
     float dy = tgtY-posY;
     float d = (float) sqrt(pow(dx, 2) + pow(dy, 2));
     // float localLinear = (float) pow(kp_n*d, kn_n);
-    float localLinear = (float) pow(kp_n*std::max(distances.min, (float) 0.1), kn_n);
+    // Clearance from the scan cone, or from the distance field where it sees something closer
+    // outside the cone
+    float clearance = std::min(distances.min, esdfDistance(posX, posY));
+    float localLinear = (float) pow(kp_n*std::max(clearance, (float) 0.1), kn_n);
 
-    applyMagnitudeLimits(localLinear, minLinear, maxLinear);
+    applyMagnitudeLimits(localLinear, minLinear, std::max(minLinear, governedSpeedLimit(localLinear, angular)));
 
     return localLinear;
 }
@@ -78,9 +103,9 @@ void computeTargetCoordinate(float distance, float angle, float posX, float posY
     tgtY = posY + distance * std::sin(Deg2Rad(angle + yaw));
 }
 
-void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
     ROS_INFO("rotateToHeading() called with current/target headings of %.2f/%.2f...", yaw, targetHeading);
-    ros::spinOnce();
+    spinSensors();
     
     float proportional;
     int counter = 0;
@@ -93,15 +118,15 @@ void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publis
         targetHeading -= 360;
     }
 
-    while(abs(targetHeading - yaw) > rotationTolerance){
+    while(abs(targetHeading - yaw) > rotationTolerance && !cancel.requested()){
 
         angular = computeAngular(targetHeading, yaw);
         linear = 0;
 
-        ros::spinOnce();
+        spinSensors();
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
 
         counter ++;
         // if(counter %10000000 == 0){
@@ -112,15 +137,70 @@ void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publis
 
     vel.angular.z = 0;
     vel.linear.x = 0;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
     ROS_INFO("...rotateToHeading() completed.");
 
 }
 
-void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
-    ROS_INFO("navigateToPosition() called with target(%.2f, %.2f)...", tgtX, tgtY);
-    ros::spinOnce();
+void turnByAngle(float deltaDeg, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    ROS_INFO("turnByAngle() called with %.1f degrees from heading %.2f...", deltaDeg, yaw);
+    spinSensors();
+
+    float lastYaw = yaw;
+    float turned = 0;
+    float rate = 0;     // Signed angular rate command, degrees per second
+    double lastTime = clockNow();
+
+    while(!cancel.requested()){
+        spinSensors();
+
+        double now = clockNow();
+        float dt = std::max(0.0, now - lastTime);
+        lastTime = now;
+
+        // Accumulate the measured rotation so turns of 180 degrees or more survive the yaw wrap
+        float step = yaw - lastYaw;
+        while(step > 180) step -= 360;
+        while(step < -180) step += 360;
+        turned += step;
+        lastYaw = yaw;
+
+        float remaining = deltaDeg - turned;
+        if(std::abs(remaining) < turnTolerance){
+            break;
+        }
+
+        // Trapezoidal profile: ramp at turnAngularAccel, cruise at turnMaxAngular and brake
+        // so the rate reaches zero exactly at the target
+        if(rate * remaining < 0){
+            rate = 0;   // Overshot, restart the ramp in the other direction
+        }
+        float brakeLimit = std::sqrt(2 * turnAngularAccel * std::abs(remaining));
+        float speed = std::min(std::abs(rate) + turnAngularAccel * dt, std::min(turnMaxAngular, brakeLimit));
+        speed = std::max(speed, turnMinAngular);
+        rate = remaining < 0 ? -speed : speed;
+
+        angular = Deg2Rad(rate);
+        linear = 0;
+        vel.angular.z = angular;
+        vel.linear.x = linear;
+        publishVelocity(vel, vel_pub);
+    }
+
+    angular = 0;
+    linear = 0;
+    vel.angular.z = angular;
+    vel.linear.x = linear;
+    stopVelocity(vel_pub);
+
+    ROS_INFO("...turnByAngle() completed at heading %.2f.", yaw);
+}
+
+void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    BehaviorScope behavior(BEHAVIOR_NAVIGATION);
+    logEvent(EV_NAVIGATE_START, tgtX, tgtY);
+    spinSensors();
 
     int counter = 0;
     int bumperHits = 0;
@@ -132,24 +212,38 @@ void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::
 
     // Set and rotate to initial heading
     float targetHeading = Rad2Deg(atan2(dy, dx));
-    rotateToHeading(targetHeading, vel, vel_pub);
+    rotateToHeading(targetHeading, vel, vel_pub, cancel);
+
+    float bestDistance = d;
+    double lastProgress = clockNow();
 
     // While loop until robot gets there
-    while(d > navigationTolerance){
-        ros::spinOnce();
+    while(d > navigationTolerance && !cancel.requested()){
+        spinSensors();
         dx = tgtX-posX;
         dy = tgtY-posY;
         d = (float) sqrt(pow(dx, 2) + pow(dy, 2));
 
+        // The governor can hold the robot at zero in front of an obstacle the bumpers never touch
+        double now = clockNow();
+        if(d < bestDistance - navigationProgressDistance){
+            bestDistance = d;
+            lastProgress = now;
+        }
+        else if(now - lastProgress > navigationProgressTimeout){
+            ROS_INFO("navigateToPosition() | giving up, no progress for %.0f s at %.2f m", now - lastProgress, d);
+            break;
+        }
+
         if(bumpers.anyPressed && (bumperHits >= bumperHitsLimit || d < navigationBumperExitTolerance)){
-            checkBumper(vel, vel_pub);
+            checkBumper(vel, vel_pub, cancel);
             return;
         }
 
         else if (bumpers.anyPressed){
             bumperHits ++;
-            ROS_INFO("WARNING: BUMPER HITS: %d", bumperHits);
-            checkBumper(vel, vel_pub);
+            logEvent(EV_NAVIGATE_BUMPER_HIT, bumperHits, posX, posY);
+            checkBumper(vel, vel_pub, cancel);
             
         }
         
@@ -163,7 +257,7 @@ void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
 
         counter ++;
         
@@ -177,14 +271,157 @@ void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::
     angular = 0;
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
-    ROS_INFO("...navigateToPosition completed.");
+    logEvent(EV_NAVIGATE_END, posX, posY);
 }
 
-void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+// Pure pursuit: steer along the arc through the point one lookahead distance further along the
+// path. The lookahead grows with speed so fast stretches cut corners smoothly, and speed follows
+// the same PN law as computeLinear() on the clearance and on the path length left. A lookahead
+// point behind the robot has no sensible arc, so the robot turns in place towards it first.
+bool followPath(const std::vector<std::array<float, 2>> &path, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    BehaviorScope behavior(BEHAVIOR_NAVIGATION);
+    ROS_INFO("followPath() called with %zu waypoints...", path.size());
+    if(path.empty()){
+        return false;
+    }
+
+    spinSensors();
+    setScenePath(path);
+    ClockRate trackRate(pathTrackRate);
+    size_t segment = 0;     // Path index the robot is currently between (segment, segment + 1)
+    bool reached = false;
+    int bumperHits = 0;
+    float bestRemaining = std::numeric_limits<float>::infinity();
+    double lastProgress = clockNow();
+
+    while(controlOk() && !cancel.requested()){
+        spinSensors();
+
+        const std::array<float, 2> &goal = path.back();
+        if(distanceBetween(posX, posY, goal[0], goal[1]) < navigationTolerance){
+            reached = true;
+            break;
+        }
+
+        if(bumpers.anyPressed){
+            bumperHits ++;
+            logEvent(EV_NAVIGATE_BUMPER_HIT, bumperHits, posX, posY);
+            checkBumper(vel, vel_pub, cancel);
+            if(bumperHits >= navigationBumperHitsLimit){
+                ROS_INFO("followPath() | giving up after %d bumper hits", bumperHits);
+                break;
+            }
+        }
+
+        // 1. Project the robot onto the path, only ever moving forward along it
+        float along = 0;    // Distance of the projection past path[segment]
+        while(true){
+            if(segment + 1 >= path.size()){
+                along = 0;
+                break;
+            }
+            float sx = path[segment + 1][0] - path[segment][0];
+            float sy = path[segment + 1][1] - path[segment][1];
+            float length = std::max(std::hypot(sx, sy), 1e-6f);
+            along = ((posX - path[segment][0]) * sx + (posY - path[segment][1]) * sy) / length;
+
+            if(along < length){
+                along = std::max(along, 0.0f);
+                break;
+            }
+            segment++;
+        }
+
+        // 2. Walk the lookahead distance along the path from the projection
+        float lookahead = std::max(lookaheadMin, std::min(lookaheadMax, lookaheadMin + lookaheadGain * std::abs(linear)));
+        float remainingPath = -along;
+        float lookX = goal[0];
+        float lookY = goal[1];
+        float budget = lookahead + along;
+        bool found = false;
+
+        for(size_t i = segment; i + 1 < path.size(); i++){
+            float sx = path[i + 1][0] - path[i][0];
+            float sy = path[i + 1][1] - path[i][1];
+            float length = std::hypot(sx, sy);
+            remainingPath += length;
+
+            if(!found && budget <= length && length > 1e-6f){
+                lookX = path[i][0] + sx * budget / length;
+                lookY = path[i][1] + sy * budget / length;
+                found = true;
+            }
+            budget -= length;
+        }
+        if(segment + 1 >= path.size()){
+            remainingPath = distanceBetween(posX, posY, goal[0], goal[1]);
+        }
+
+        double now = clockNow();
+        if(remainingPath < bestRemaining - navigationProgressDistance){
+            bestRemaining = remainingPath;
+            lastProgress = now;
+        }
+        else if(now - lastProgress > navigationProgressTimeout){
+            ROS_INFO("followPath() | giving up, no progress for %.0f s with %.2f m of path left", now - lastProgress, remainingPath);
+            break;
+        }
+
+        // 3. Curvature of the arc through the lookahead point, in the robot frame
+        float dx = lookX - posX;
+        float dy = lookY - posY;
+        float c = std::cos(Deg2Rad(yaw));
+        float s = std::sin(Deg2Rad(yaw));
+        float localX = c * dx + s * dy;
+        float localY = -s * dx + c * dy;
+        float curvature = 2 * localY / std::max(localX * localX + localY * localY, 1e-6f);
+
+        if(localX <= 0){
+            // Behind the robot: the arc would lead away from the path, turn towards the point
+            linear = 0;
+            angular = computeAngular(Rad2Deg(atan2(dy, dx)), yaw);
+            vel.angular.z = angular;
+            vel.linear.x = linear;
+            publishVelocity(vel, vel_pub);
+            trackRate.sleep();
+            continue;
+        }
+
+        // 4. PN speed on clearance and on path left, then capped so the turn rate stays reachable
+        float clearanceSpeed = computeLinear(goal[0], goal[1], posX, posY);
+        float pathSpeed = (float) pow(kp_n * std::max(remainingPath, 0.0f), kn_n);
+        applyMagnitudeLimits(pathSpeed, minLinear, maxLinear);
+
+        linear = std::min(clearanceSpeed, pathSpeed);
+        if(std::abs(curvature) > 1e-6f){
+            linear = std::min(linear, (float) Deg2Rad(maxAngular) / std::abs(curvature));
+        }
+        linear = std::max(linear, minLinear);
+        angular = linear * curvature;
+        applyMagnitudeLimits(angular, 0, Deg2Rad(maxAngular));
+
+        vel.angular.z = angular;
+        vel.linear.x = linear;
+        publishVelocity(vel, vel_pub);
+
+        trackRate.sleep();
+    }
+
+    linear = 0;
+    angular = 0;
+    vel.angular.z = angular;
+    vel.linear.x = linear;
+    stopVelocity(vel_pub);
+
+    ROS_INFO("...followPath() completed.");
+    return reached;
+}
+
+void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
     ROS_INFO("rotateToStarting called with target(%.2f, %.2f)...", tgtX, tgtY);
-    ros::spinOnce();
+    spinSensors();
 
     int counter = 0;
     int bumperHits = 0;
@@ -196,7 +433,7 @@ void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Pu
 
     // Set and rotate to initial heading
     float targetHeading = Rad2Deg(atan2(dy, dx));
-    rotateToHeading(targetHeading, vel, vel_pub);
+    rotateToHeading(targetHeading, vel, vel_pub, cancel);
 
     // While loop until robot gets there
 
@@ -208,7 +445,7 @@ void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Pu
 
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    publishVelocity(vel, vel_pub);
 
 
 
@@ -216,230 +453,113 @@ void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Pu
     angular = 0;
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
 
     ROS_INFO("...rotateToStarting completed.");
 }
 
-void navigateToPositionSmart(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
-    ROS_INFO("navigateToPositionSmart(...) called");
-    
+bool navigateToPositionSmart(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    BehaviorScope behavior(BEHAVIOR_NAVIGATION);
+    ROS_INFO("navigateToPositionSmart() called with target(%.2f, %.2f)...", tgtX, tgtY);
+
     // Setup
-    ros::spinOnce();
-    bool followingWall = false;
-    bool obstacleAhead = false;
-    float dx, dy, d;
+    spinSensors();
+    float d;
     float exitThreshold = 0.45;
+    bool reached = false;
+    int bumperHits = 0;
 
-    float sideOpenDistThreshold = 0.7;
-
-    float advanceDistance;
-    float headingThreshold = 2; // Degrees
-
-    std::string followingMode = "none";
-
-    // One-time major heading adjustment to face target
-    dx = tgtX-posX;
-    dy = tgtY-posY;
+    float dx = tgtX-posX;
+    float dy = tgtY-posY;
+    float bestDistance = (float) sqrt(pow(dx, 2) + pow(dy, 2));
+    double lastProgress = clockNow();
 
-    float targetHeading = Rad2Deg(atan2(dy, dx));
-    rotateToHeading(targetHeading, vel, vel_pub);
-    uint16_t counter = 0;
+    static DwaObstacles obstacles;
+    DwaLimits limits = {maxLinear, (float) Deg2Rad(maxAngular), maxLinearAccel, maxAngularAccel};
+    ClockRate planRate(dwaPlanRate);
 
     // Loop
-    while(true){
-        ros::spinOnce();
-        counter ++;
-        // ROS_INFO("LEFT HORZ/RAY: %.2f/%.2f", distances.leftHorz, distances.leftRay);
+    while(controlOk() && !cancel.requested()){
+        spinSensors();
 
-        // Recalculate dx, dy, d, targetHeading
         dx = tgtX-posX;
         dy = tgtY-posY;
         d = (float) sqrt(pow(dx, 2) + pow(dy, 2));
-        targetHeading = Rad2Deg(atan2(dy, dx));
 
-        checkBumper(vel, vel_pub);
-
-        // Exit Condition
-        if(d < exitThreshold){
-            return;
+        if(bumpers.anyPressed){
+            bumperHits ++;
+            logEvent(EV_NAVIGATE_BUMPER_HIT, bumperHits, posX, posY);
+            checkBumper(vel, vel_pub, cancel);
+            if(bumperHits >= navigationBumperHitsLimit){
+                ROS_INFO("navigateToPositionSmart() | giving up after %d bumper hits", bumperHits);
+                break;
+            }
         }
 
-
-        // 1. Check if there are obstacles ahead
-        if(distances.min < 0.51){
-            obstacleAhead = true;
+        // Exit Conditions
+        if(d < exitThreshold){
+            reached = true;
+            break;
         }
-        else {
-            obstacleAhead = false;
+        double now = clockNow();
+        if(d < bestDistance - navigationProgressDistance){
+            bestDistance = d;
+            lastProgress = now;
         }
-        
-        // 2a. NO OBSTACLE MOVEMENT | If no obstacles ahead, calculate linear/angular and continue moving to target
-        if(!obstacleAhead && !followingWall){
-
-
-            linear = computeLinear(tgtX, tgtY, posX, posY);
-
-            minAngular = 0;
-            angular = computeAngular(targetHeading, yaw);
-            minAngular = 15;
-
-            // if(counter %50000 == 0){
-            //     ROS_INFO("nTPS().2a | Tgt X/Y: %f/%f | Pos X/Y: %f/%f | Lin/Ang: %f/%f", tgtX, tgtY, posX, posY, linear, Rad2Deg(angular));
-            // }
-            
+        else if(now - lastProgress > navigationProgressTimeout){
+            ROS_INFO("navigateToPositionSmart() | giving up, no progress for %.0f s at %.2f m from the target", now - lastProgress, d);
+            break;
         }
-        
-
-        // 2b. WALL FOLLOWING SETUP | If obstacles ahead, set followingWall to true and followingMode to left or right.
-        else if(obstacleAhead && !followingWall){
-            followingWall = true;
 
-            ROS_INFO("R/L Horz Distance %.2f/%.2f", distances.rightHorz, distances.leftHorz);
-
-            if(distances.rightRay > distances.leftRay){
-                followingMode = "left";
-                ROS_INFO("FOLLOWING WALL ON LEFT");
+        // Goal in the robot frame
+        float c = std::cos(Deg2Rad(yaw));
+        float s = std::sin(Deg2Rad(yaw));
+        float goalX = c * dx + s * dy;
+        float goalY = -s * dx + c * dy;
+
+        recordDataAge(METRIC_SCAN_AGE, scanReceivedTicks);
+        recordDataAge(METRIC_ODOM_AGE, odomReceivedTicks);
+        DwaCommand cmd;
+        {
+            ScopedMetric probe(METRIC_DWA_PLAN);
+            // A scan without a single finite return means the Kinect is up against something
+            // (everything closer than range_min), not that the way is clear
+            bool sawReturns = gatherScanObstacles(scan, obstacles);
+            gatherContactObstacles(posX, posY, yaw, contactObstacleRange, obstacles);
+            // Arcs that turn out of the fan are checked against what the robot has driven past
+            gatherMemoryObstacles(posX, posY, yaw, memoryObstacleRange, obstacles);
+            if(sawReturns){
+                cmd = planDwa(obstacles, goalX, goalY, linear, angular, limits);
             }
-
-            else{
-                followingMode = "right";
-                ROS_INFO("FOLLOWING WALL ON RIGHT");
+            else {
+                cmd.valid = false;
             }
         }
 
-
-
-        // 3. WALL FOLLOWING | If supposed to be following wall, continue following wall until exit condition triggers
-        if(followingWall){
-
-
-            // 3A FOLLOW WALL ON LEFT | Right distance is greater than left -> follow wall on left
-            if(followingMode == "left"){
-                // Wall following kinematics computation
-                if (distances.frontRay > 1.0) {
-    
-                    const double k = 0.7;   // Scaling factor for angular velocity
-                    const double alpha = 1.5; // Exponential growth/decay rate
-                    float targetDistance = 0.9;
-
-                    if (distances.leftRay < targetDistance) {
-                        angular = -k * (1-exp(-alpha * distances.leftRay)); // Exponential decay for left turns
-                        linear = 0.1;                                   // Set a constant forward speed
-                    } 
-                    else if (distances.leftRay > targetDistance) {
-                        angular = k * (1-exp(-alpha * distances.leftRay));  // Exponential decay for right turns
-                        linear = 0.1;                                   // Set a constant forward speed
-                    } 
-                    else {
-                        angular = 0.0;                                  // No angular adjustment
-                        linear = 0.1;                                   // Maintain forward speed
-                    }
-                }
-
-                else {
-                    linear = 0.04;
-                    angular = -0.26;                     // Rotate in place to adjust to right
-                }
-
-                // Check if sudden opening
-                if(distances.leftHorzPrev < sideOpenDistThreshold && distances.leftHorz > sideOpenDistThreshold){
-                    ROS_INFO("OPENING DETECTED WHILE FOLLOWING WALL ON LEFT");
-                    followingMode = "leftAdvanced";
-                    advanceDistance = distances.leftVertPrev + 0.1;
-                    float tgtX;
-                    float tgtY;
-
-                    computeAdvanceCoordinate(advanceDistance, yaw, posX, posY, tgtX, tgtY);
-                    navigateToPosition(tgtX, tgtY, vel, vel_pub);
-                }
-
-
-            }
-
-            else if (followingMode == "leftAdvanced"){
-                linear = 0.1;
-                angular = Deg2Rad((float) 15);
-                
-                // Return to normal navigation if turned to the correct heading
-                if(std::abs(targetHeading - yaw) < headingThreshold && distances.frontRay > 0.51){
-                    followingMode = "none";
-                    followingWall = false;
-
-                }
-                
-            }
-
-            // 3B FOLLOW WALL ON RIGHT | Left distance is greater than right -> follow wall on right
-            else if (followingMode == "right"){
-                // Wall following kinematics computation
-                if (distances.frontRay > 1.0) {
-                    const double k = 0.7;   // Scaling factor for angular velocity
-                    const double alpha = 1.5; // Exponential growth/decay rate
-                    float targetDistance = 0.9;
-
-                    if (distances.rightRay < targetDistance) {
-                        angular = k * (1-exp(-alpha * distances.rightRay)); // Exponential decay for left turns
-                        linear = 0.1;                                   // Set a constant forward speed
-                    } 
-                    else if (distances.rightRay > targetDistance) {
-                        angular = -k * (1-exp(-alpha * distances.rightRay));  // Exponential decay for right turns
-                        linear = 0.1;                                   // Set a constant forward speed
-                    } 
-                    else {
-                        angular = 0.0;                                  // No angular adjustment
-                        linear = 0.1;                                   // Maintain forward speed
-                    }
-                }
-
-                else {
-                    linear = 0.04;
-                    angular = 0.26;                     // Rotate in place to adjust to right
-                }
-
-                // Check if sudden opening
-                if(distances.rightHorzPrev < sideOpenDistThreshold && distances.rightHorz > sideOpenDistThreshold){
-                    ROS_INFO("OPENING DETECTED WHILE FOLLOWING WALL ON RIGHT");
-                    followingMode = "rightAdvanced";
-                    advanceDistance = distances.rightVertPrev + 0.1;
-                    float tgtX;
-                    float tgtY;
-
-                    computeAdvanceCoordinate(advanceDistance, yaw, posX, posY, tgtX, tgtY);
-                    navigateToPosition(tgtX, tgtY, vel, vel_pub);
-                }
-                //ROS_INFO("FOLLOWING WALL ON RIGHT");
-            }
-        
-
-            else if (followingMode == "rightAdvanced"){
-                linear = 0.1;
-                angular = Deg2Rad((float) -15);
-                
-                // Return to normal navigation if turned to the correct heading
-                if(std::abs(targetHeading - yaw) < headingThreshold && distances.frontRay > 0.51){
-                    followingMode = "none";
-                    followingWall = false;
-
-                }
-                
-            }
-
+        if(cmd.valid){
+            linear = cmd.linear;
+            angular = cmd.angular;
+            setScenePathArc(posX, posY, yaw, linear, angular, dwaHorizon);
+        }
+        else {
+            // Every trajectory collides: turn in place towards the more open side
+            linear = 0;
+            angular = distances.leftRay > distances.rightRay ? Deg2Rad(minAngular) : -Deg2Rad(minAngular);
         }
-        // else {
-        //     linear = 0.0;
-        //     angular = 0.0;
-        //     ROS_INFO("navigateToPositionSmart: CASE NOT HANDLED");
-        // }
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
+
+        planRate.sleep();
     }
-    
+
     angular = 0;
     linear = 0;
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
+
+    ROS_INFO("...navigateToPositionSmart completed.");
+    return reached;
 }
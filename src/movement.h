@@ -2,8 +2,23 @@
 #define movementHeader
 
 #include "common.h"
+#include "cancelToken.h"
 #include "laser.h"
 #include "bumper.h"
+#include "velocityProfiler.h"
+#include "dwaPlanner.h"
+#include "distanceField.h"
+#include "speedGovernor.h"
+#include "obstacleMemory.h"
+#include "contactLayer.h"
+#include "tfCache.h"
+#include "visualization.h"
+#include "eventLog.h"
+#include "metrics.h"
+#include "commandTrace.h"
+#include "sensorMailbox.h"
+#include "commandArbiter.h"
+#include "clock.h"
 
 
 void odomCallback(const nav_msgs::Odometry::ConstPtr& msg);
@@ -16,13 +31,20 @@ void computeAdvanceCoordinate(float distance, float yaw, float posX, float posY,
 
 void computeTargetCoordinate(float distance, float angle, float posX, float posY, float yaw, float &tgtX, float &tgtY);
 
-void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+void rotateToHeading(float targetHeading, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 
-void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+void turnByAngle(float deltaDeg, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 
-void navigateToPositionSmart(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+void navigateToPosition(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 
-void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+// Tracks a waypoint path with pure pursuit; gives up like navigateToPositionSmart()
+bool followPath(const std::vector<std::array<float, 2>> &path, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+
+// Drives to within 0.45 m of the target with the DWA planner. Gives up after too many bumper
+// hits or too long without getting closer; returns whether the target was reached.
+bool navigateToPositionSmart(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+
+void rotateToStarting(float tgtX, float tgtY, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 
 #endif
 
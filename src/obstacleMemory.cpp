@@ -0,0 +1,163 @@
+#include "obstacleMemory.h"
+
+size_t memoryCapacity = 4096;
+double memoryMaxAge = 8.0;          // s
+float memoryMaxTravel = 3.0;        // m of driving
+float memoryMaxRange = 2.5;         // Only remember points this close (m)
+float memoryRaySpacing = 1.0;       // Degrees between remembered rays
+float memoryEmptyRange = 10.0;      // Reported for sectors with nothing in them (m)
+float memorySeenTolerance = 0.05;   // A return this far past a held point still counts as seeing it (m)
+float sectorRefreshTravel = 0.05;   // m the robot may move before the sector table is rebuilt
+float sectorRefreshTurn = 2.0;      // Degrees the robot may turn before the sector table is rebuilt
+
+ObstacleMemory obstacleMemory = {std::vector<MemoryPoint>(memoryCapacity), 0, 0, {}, 0, 0, 0, 0, 0, false, {}, true, 0, 0, 0};
+
+static int sectorIndex(float bearingDeg){
+    int sector = (int) std::floor((bearingDeg + 180.0f / memorySectors) * memorySectors / 360.0f);
+    wrapIntegerIndexAroundRange(sector, 0, memorySectors - 1);
+    return sector;
+}
+
+static void advanceOdometer(float posX, float posY){
+    if(obstacleMemory.havePose){
+        obstacleMemory.odometer += distanceBetween(obstacleMemory.lastX, obstacleMemory.lastY, posX, posY);
+    }
+    obstacleMemory.lastX = posX;
+    obstacleMemory.lastY = posY;
+    obstacleMemory.havePose = true;
+}
+
+static void rememberPoint(const MemoryPoint &point){
+    ObstacleMemory &memory = obstacleMemory;
+    memory.ring[memory.head] = point;
+
+    // Oldest points are overwritten once the ring is full
+    memory.head = (memory.head + 1) % memory.ring.size();
+    memory.count = std::min(memory.count + 1, memory.ring.size());
+    memory.sectorsDirty = true;
+}
+
+// The scan still sees a point when the ray at its bearing returns at or short of it. A NaN ray,
+// which is what the Kinect reports inside its minimum range, or one reaching further leaves the
+// point unconfirmed.
+static bool seenAgain(const ScanStruct &scan, float bearing, float range){
+    int i = (int) std::lround((bearing - scan.angleMin) / scan.angleIncrement);
+    if(i < 0 || i >= (int) scan.ranges.size()) return false;
+
+    float ray = scan.ranges[i];
+    return std::isfinite(ray) && ray >= scan.rangeMin && ray <= range + memorySeenTolerance;
+}
+
+void observeScanObstacles(const ScanStruct &scan, float posX, float posY, float yawDeg, double now){
+    if(scan.ranges.empty() || scan.angleIncrement <= 0){
+        return;
+    }
+    advanceOdometer(posX, posY);
+
+    ObstacleMemory &memory = obstacleMemory;
+    memory.fanMin = scan.angleMin;
+    memory.fanMax = scan.angleMin + (scan.ranges.size() - 1) * scan.angleIncrement;
+
+    // 1. Points of the previous scan this scan does not see again are remembered: those the fan
+    //    has left, and those whose ray now comes back empty, such as an obstacle the robot has
+    //    closed to inside the Kinect's minimum range
+    for(const MemoryPoint &point : memory.inFan){
+        float bearing = std::remainder(std::atan2(point.y - posY, point.x - posX) - Deg2Rad(yawDeg), 2 * M_PI);
+        if(bearing < memory.fanMin || bearing > memory.fanMax
+            || !seenAgain(scan, bearing, distanceBetween(posX, posY, point.x, point.y))){
+            rememberPoint(point);
+        }
+    }
+    memory.inFan.clear();
+
+    // 2. Hold this scan's points until the fan leaves them
+    int stride = std::max(1, (int) std::lround(Deg2Rad(memoryRaySpacing) / scan.angleIncrement));
+    for(size_t i = 0; i < scan.ranges.size(); i += stride){
+        float range = scan.ranges[i];
+        if(!std::isfinite(range) || range < scan.rangeMin || range > memoryMaxRange) continue;
+
+        float bearing = Deg2Rad(yawDeg) + scan.angleMin + i * scan.angleIncrement;
+        memory.inFan.push_back({posX + range * std::cos(bearing), posY + range * std::sin(bearing), now, memory.odometer});
+    }
+
+    refreshObstacleSectors(posX, posY, yawDeg, now);
+}
+
+static void addToSectors(const MemoryPoint &point, float posX, float posY, float yawDeg){
+    float dx = point.x - posX;
+    float dy = point.y - posY;
+    float range = std::hypot(dx, dy);
+    float bearing = Rad2Deg(std::atan2(dy, dx)) - yawDeg;
+
+    float &nearest = obstacleMemory.sectors[sectorIndex(bearing)];
+    nearest = std::min(nearest, range);
+}
+
+void refreshObstacleSectors(float posX, float posY, float yawDeg, double now){
+    ObstacleMemory &memory = obstacleMemory;
+    advanceOdometer(posX, posY);
+
+    // 1. Expire from the old end; the ring is in insertion order so this stops at the first keeper
+    while(memory.count > 0){
+        size_t oldest = (memory.head + memory.ring.size() - memory.count) % memory.ring.size();
+        const MemoryPoint &point = memory.ring[oldest];
+        if(now - point.stamp < memoryMaxAge && memory.odometer - point.odometer < memoryMaxTravel){
+            break;
+        }
+        memory.count--;
+        memory.sectorsDirty = true;
+    }
+
+    // 2. Rebuild the egocentric sector table, only once it has gone stale
+    float turned = std::abs(std::remainder(yawDeg - memory.sectorsYaw, 360.0f));
+    if(!memory.sectorsDirty && turned < sectorRefreshTurn
+        && distanceBetween(posX, posY, memory.sectorsX, memory.sectorsY) < sectorRefreshTravel){
+        return;
+    }
+    memory.sectorsDirty = false;
+    memory.sectorsX = posX;
+    memory.sectorsY = posY;
+    memory.sectorsYaw = yawDeg;
+
+    memory.sectors.fill(memoryEmptyRange);
+    for(size_t k = 0; k < memory.count; k++){
+        addToSectors(memory.ring[(memory.head + memory.ring.size() - 1 - k) % memory.ring.size()], posX, posY, yawDeg);
+    }
+    for(const MemoryPoint &point : memory.inFan){
+        addToSectors(point, posX, posY, yawDeg);
+    }
+}
+
+float nearestObstacleAt(float bearingDeg){
+    return obstacleMemory.sectors[sectorIndex(bearingDeg)];
+}
+
+float nearestObstacleInArc(float fromDeg, float toDeg){
+    float span = toDeg - fromDeg;
+    while(span < 0) span += 360;
+
+    int first = sectorIndex(fromDeg);
+    int sectors = std::min(memorySectors, (int) std::ceil(span * memorySectors / 360.0f) + 1);
+
+    float nearest = memoryEmptyRange;
+    for(int k = 0; k < sectors; k++){
+        nearest = std::min(nearest, obstacleMemory.sectors[(first + k) % memorySectors]);
+    }
+    return nearest;
+}
+
+void gatherMemoryObstacles(float posX, float posY, float yawDeg, float range, DwaObstacles &obstacles){
+    const ObstacleMemory &memory = obstacleMemory;
+    float c = std::cos(Deg2Rad(yawDeg));
+    float s = std::sin(Deg2Rad(yawDeg));
+
+    for(size_t k = 0; k < memory.count; k++){
+        const MemoryPoint &point = memory.ring[(memory.head + memory.ring.size() - 1 - k) % memory.ring.size()];
+        float dx = point.x - posX;
+        float dy = point.y - posY;
+        if(dx * dx + dy * dy > range * range) continue;
+
+        obstacles.x.push_back(c * dx + s * dy);
+        obstacles.y.push_back(-s * dx + c * dy);
+    }
+}
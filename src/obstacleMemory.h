@@ -0,0 +1,60 @@
+#ifndef obstacleMemoryHeader
+#define obstacleMemoryHeader
+
+#include "common.h"
+#include "dwaPlanner.h"
+
+// Short-term memory of obstacle points for the sides the Kinect's 57 degree fan cannot see.
+// Points are kept in the odom frame, so odometry carries them along as the robot moves. The
+// newest scan's points are held aside; a point only enters the fixed-size ring, ordered by age,
+// once the next scan no longer sees it, because the fan has moved off it or its ray came back
+// empty. The ring holds what is beside, behind and too close to the robot rather than the same
+// view 10 times a second. Ring points expire after memoryMaxAge seconds or memoryMaxTravel
+// metres of driving, whichever comes first. A per-sector table of the nearest point around the
+// robot, held and remembered points alike, is rebuilt when the ring gains or loses points or the
+// robot has moved or turned enough to shift it, so 360 degree queries cost O(sectors).
+
+const int memorySectors = 36;       // 10 degree sectors, sector 0 centred on the heading
+
+struct MemoryPoint{
+    float x;
+    float y;
+    double stamp;
+    float odometer;     // Distance driven when the point was seen
+};
+
+struct ObstacleMemory{
+    std::vector<MemoryPoint> ring;
+    size_t head;        // Next slot to write
+    size_t count;
+    std::vector<MemoryPoint> inFan;     // Points of the newest scan, not in the ring yet
+    float fanMin;       // Bearings of the newest scan's fan (rad, robot frame)
+    float fanMax;
+    float odometer;
+    float lastX;
+    float lastY;
+    bool havePose;
+    std::array<float, memorySectors> sectors;   // Nearest range per sector from the robot centre (m)
+    bool sectorsDirty;  // The ring gained or expired points since the table was built
+    float sectorsX;     // Pose the table was built at
+    float sectorsY;
+    float sectorsYaw;
+};
+
+extern ObstacleMemory obstacleMemory;
+
+void observeScanObstacles(const ScanStruct &scan, float posX, float posY, float yawDeg, double now);
+
+void refreshObstacleSectors(float posX, float posY, float yawDeg, double now);
+
+// Nearest remembered obstacle in the sector containing bearingDeg (robot frame, + is left)
+float nearestObstacleAt(float bearingDeg);
+
+// Nearest remembered obstacle with a bearing between fromDeg and toDeg, counterclockwise
+float nearestObstacleInArc(float fromDeg, float toDeg);
+
+// Append ring points within range of the robot to a planner obstacle set, in the robot frame.
+// The newest scan's own points are left out, the planner reads the scan directly.
+void gatherMemoryObstacles(float posX, float posY, float yawDeg, float range, DwaObstacles &obstacles);
+
+#endif
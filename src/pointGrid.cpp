@@ -0,0 +1,78 @@
+#include "pointGrid.h"
+
+float pointGridMaxLoad = 0.7;   // Fraction of slots that may be used before inserts of new cells fail
+
+PointGrid::PointGrid(float cellSize, size_t capacity, GridMerge merge) : cellSize(cellSize), merge(merge), sequence(0){
+    size_t slots = 16;
+    while(slots * pointGridMaxLoad < capacity){
+        slots *= 2;
+    }
+
+    table.assign(slots, GridCell());
+    for(size_t i = 0; i < slots; i++){
+        table[i].used = false;
+    }
+    mask = slots - 1;
+    maxCells = capacity;
+    occupied.reserve(capacity);
+}
+
+static size_t hashCell(int32_t ix, int32_t iy){
+    // 2D spatial hash (Teschner et al.) with the product mixed down into the low bits
+    uint64_t h = (uint64_t) (uint32_t) ix * 73856093u ^ (uint64_t) (uint32_t) iy * 19349663u;
+    h ^= h >> 17;
+    h *= 0xed5ad4bbu;
+    h ^= h >> 11;
+    return (size_t) h;
+}
+
+void clearPointGrid(PointGrid &grid){
+    for(size_t i = 0; i < grid.occupied.size(); i++){
+        grid.table[grid.occupied[i]].used = false;
+    }
+    grid.occupied.clear();
+    grid.sequence = 0;
+}
+
+static size_t probeSlot(const PointGrid &grid, int32_t ix, int32_t iy){
+    size_t slot = hashCell(ix, iy) & grid.mask;
+    while(grid.table[slot].used && (grid.table[slot].ix != ix || grid.table[slot].iy != iy)){
+        slot = (slot + 1) & grid.mask;
+    }
+    return slot;
+}
+
+const GridCell *insertPoint(PointGrid &grid, float x, float y){
+    int32_t ix = (int32_t) std::floor(x / grid.cellSize);
+    int32_t iy = (int32_t) std::floor(y / grid.cellSize);
+    size_t slot = probeSlot(grid, ix, iy);
+    GridCell &cell = grid.table[slot];
+
+    if(!cell.used){
+        if(grid.occupied.size() >= grid.maxCells){
+            return nullptr;
+        }
+        cell = {ix, iy, x, y, 0, 0, true};
+        grid.occupied.push_back(slot);
+    }
+
+    cell.count++;
+    cell.order = grid.sequence++;
+
+    if(grid.merge == GRID_MEAN){
+        cell.x += (x - cell.x) / cell.count;
+        cell.y += (y - cell.y) / cell.count;
+    }
+    else {
+        cell.x = x;
+        cell.y = y;
+    }
+    return &cell;
+}
+
+const GridCell *findCell(const PointGrid &grid, float x, float y){
+    int32_t ix = (int32_t) std::floor(x / grid.cellSize);
+    int32_t iy = (int32_t) std::floor(y / grid.cellSize);
+    const GridCell &cell = grid.table[probeSlot(grid, ix, iy)];
+    return cell.used ? &cell : nullptr;
+}
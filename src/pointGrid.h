@@ -0,0 +1,45 @@
+#ifndef pointGridHeader
+#define pointGridHeader
+
+#include "common.h"
+
+// Hash grid that reduces a point stream to one representative per cell. The table is open
+// addressed and sized once at construction, so steady-state insertion allocates nothing, and
+// iterating the grid costs the number of occupied cells rather than the number of points seen.
+
+enum GridMerge { GRID_MEAN, GRID_LATEST };
+
+struct GridCell{
+    int32_t ix;
+    int32_t iy;
+    float x;            // Representative point
+    float y;
+    uint32_t count;     // Points merged into the cell
+    uint32_t order;     // Insertion sequence number of the most recent point
+    bool used;
+};
+
+struct PointGrid{
+    PointGrid(float cellSize, size_t capacity, GridMerge merge = GRID_MEAN);
+
+    float cellSize;
+    GridMerge merge;
+    std::vector<GridCell> table;        // Power of two slots
+    std::vector<uint32_t> occupied;     // Used slots, in first-insertion order
+    size_t mask;
+    size_t maxCells;
+    uint32_t sequence;
+};
+
+void clearPointGrid(PointGrid &grid);
+
+// Returns the merged cell, or nullptr if the grid is full and the point falls in a new cell
+const GridCell *insertPoint(PointGrid &grid, float x, float y);
+
+const GridCell *findCell(const PointGrid &grid, float x, float y);
+
+inline size_t gridSize(const PointGrid &grid){ return grid.occupied.size(); }
+
+inline const GridCell &gridCell(const PointGrid &grid, size_t i){ return grid.table[grid.occupied[i]]; }
+
+#endif
@@ -0,0 +1,362 @@
+#include "replay.h"
+
+#include <atomic>
+#include <cstring>
+
+size_t recordBufferSize = 1 << 20;      // stdio buffer, the control thread only ever copies into it
+int replayMismatchReports = 5;          // Mismatching commands printed in full
+
+static const char replayMagic[8] = {'M', 'I', 'E', '4', '4', '3', 'R', 'P'};
+static const uint32_t replayVersion = 1;
+
+static const char *recordNames[REPLAY_TYPES + 1] = {
+    "spin", "scan", "odom", "map", "bumper", "clock", "ok", "cancel", "preempted", "joystick",
+    "transform", "command", "end of log"
+};
+
+// Recording
+static FILE *recordFile = nullptr;
+static std::atomic<bool> recordingOn{false};
+static std::thread::id recordThread;
+static uint64_t recordCount = 0;
+
+// Replay
+static bool replayOn = false;
+static std::vector<uint8_t> replayLog;
+static size_t replayOffset = 0;
+static uint64_t replayRecords = 0;
+static bool replayEnded = false;
+static bool replayDiverged = false;
+static uint64_t commandsCompared = 0;
+static uint64_t commandMismatches = 0;
+static std::chrono::steady_clock::time_point replayStart;
+
+#pragma region Encoding
+
+struct ReplayWriter{
+    std::vector<uint8_t> bytes;
+
+    template<class T> void put(const T &value){
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(&value);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+
+    template<class T> void putArray(const std::vector<T> &values){
+        put((uint32_t) values.size());
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(values.data());
+        bytes.insert(bytes.end(), p, p + values.size() * sizeof(T));
+    }
+};
+
+struct ReplayReader{
+    const uint8_t *at;
+    const uint8_t *end;
+
+    template<class T> void get(T &value){
+        if(at + sizeof(T) > end) return;
+        std::memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+    }
+
+    template<class T> void getArray(std::vector<T> &values){
+        uint32_t count = 0;
+        get(count);
+        count = std::min<size_t>(count, (end - at) / sizeof(T));
+        values.resize(count);
+        std::memcpy(values.data(), at, count * sizeof(T));
+        at += count * sizeof(T);
+    }
+};
+
+static void putPose(ReplayWriter &out, const geometry_msgs::Pose &pose){
+    out.put(pose.position.x);
+    out.put(pose.position.y);
+    out.put(pose.position.z);
+    out.put(pose.orientation.x);
+    out.put(pose.orientation.y);
+    out.put(pose.orientation.z);
+    out.put(pose.orientation.w);
+}
+
+static void getPose(ReplayReader &in, geometry_msgs::Pose &pose){
+    in.get(pose.position.x);
+    in.get(pose.position.y);
+    in.get(pose.position.z);
+    in.get(pose.orientation.x);
+    in.get(pose.orientation.y);
+    in.get(pose.orientation.z);
+    in.get(pose.orientation.w);
+}
+
+#pragma endregion
+
+#pragma region Recording
+
+bool startRecording(const char *path){
+    recordFile = fopen(path, "wb");
+    if(recordFile == nullptr){
+        ROS_ERROR("startRecording() | cannot open %s", path);
+        return false;
+    }
+    setvbuf(recordFile, nullptr, _IOFBF, recordBufferSize);
+
+    ReplayLogHeader header = {};
+    std::memcpy(header.magic, replayMagic, sizeof(replayMagic));
+    header.version = replayVersion;
+    fwrite(&header, sizeof(header), 1, recordFile);
+
+    recordThread = std::this_thread::get_id();
+    recordCount = 0;
+    recordingOn = true;
+    ROS_INFO("startRecording() | recording controller inputs to %s", path);
+    return true;
+}
+
+void stopRecording(){
+    if(!recordingOn) return;
+    recordingOn = false;
+    fclose(recordFile);
+    recordFile = nullptr;
+    ROS_INFO("stopRecording() | %llu records", (unsigned long long) recordCount);
+}
+
+bool recording(){
+    return recordingOn.load(std::memory_order_relaxed);
+}
+
+void recordInput(ReplayRecordType type, const void *data, uint32_t size){
+    if(!recordingOn.load(std::memory_order_relaxed) || std::this_thread::get_id() != recordThread){
+        return;
+    }
+    ReplayRecordHeader header = {type, {0, 0, 0}, size};
+    fwrite(&header, sizeof(header), 1, recordFile);
+    if(size > 0){
+        fwrite(data, size, 1, recordFile);
+    }
+    recordCount++;
+}
+
+static void recordWriter(ReplayRecordType type, const ReplayWriter &out){
+    recordInput(type, out.bytes.data(), out.bytes.size());
+}
+
+void recordMessage(const sensor_msgs::LaserScan &msg){
+    if(!recording()) return;
+    ReplayWriter out;
+    out.put(msg.header.stamp.toNSec());
+    out.put(msg.angle_min);
+    out.put(msg.angle_max);
+    out.put(msg.angle_increment);
+    out.put(msg.time_increment);
+    out.put(msg.scan_time);
+    out.put(msg.range_min);
+    out.put(msg.range_max);
+    out.putArray(msg.ranges);
+    out.putArray(msg.intensities);
+    recordWriter(REPLAY_SCAN, out);
+}
+
+void recordMessage(const nav_msgs::Odometry &msg){
+    if(!recording()) return;
+    ReplayWriter out;
+    out.put(msg.header.stamp.toNSec());
+    putPose(out, msg.pose.pose);
+    out.put(msg.twist.twist.linear.x);
+    out.put(msg.twist.twist.angular.z);
+    recordWriter(REPLAY_ODOM, out);
+}
+
+void recordMessage(const nav_msgs::OccupancyGrid &msg){
+    if(!recording()) return;
+    ReplayWriter out;
+    out.put(msg.header.stamp.toNSec());
+    out.put(msg.info.resolution);
+    out.put(msg.info.width);
+    out.put(msg.info.height);
+    putPose(out, msg.info.origin);
+    out.putArray(msg.data);
+    recordWriter(REPLAY_MAP, out);
+}
+
+void recordMessage(const kobuki_msgs::BumperEvent &msg){
+    if(!recording()) return;
+    ReplayWriter out;
+    out.put(msg.bumper);
+    out.put(msg.state);
+    recordWriter(REPLAY_BUMPER, out);
+}
+
+#pragma endregion
+
+#pragma region Replay
+
+bool startReplay(const char *path){
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr){
+        ROS_ERROR("startReplay() | cannot open %s", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    replayLog.resize(std::max(length, 0L));
+    size_t read = fread(replayLog.data(), 1, replayLog.size(), file);
+    fclose(file);
+
+    ReplayLogHeader header;
+    if(read < sizeof(header)){
+        ROS_ERROR("startReplay() | %s is too short", path);
+        return false;
+    }
+    std::memcpy(&header, replayLog.data(), sizeof(header));
+    if(std::memcmp(header.magic, replayMagic, sizeof(replayMagic)) != 0 || header.version != replayVersion){
+        ROS_ERROR("startReplay() | %s is not a version %u replay log", path, replayVersion);
+        return false;
+    }
+
+    replayLog.resize(read);
+    replayOffset = sizeof(header);
+    replayOn = true;
+    replayStart = std::chrono::steady_clock::now();
+    ROS_INFO("startReplay() | replaying %zu bytes from %s", replayLog.size(), path);
+    return true;
+}
+
+bool replaying(){
+    return replayOn;
+}
+
+ReplayRecordType peekReplay(){
+    if(replayEnded || replayOffset + sizeof(ReplayRecordHeader) > replayLog.size()){
+        return REPLAY_TYPES;
+    }
+    return (ReplayRecordType) replayLog[replayOffset];
+}
+
+// Next record of the given type, or null at the end of the log or on divergence
+static const uint8_t *nextRecord(ReplayRecordType type, uint32_t &size){
+    ReplayRecordType next = peekReplay();
+    if(next == REPLAY_TYPES){
+        replayEnded = true;
+        return nullptr;
+    }
+
+    ReplayRecordHeader header;
+    std::memcpy(&header, &replayLog[replayOffset], sizeof(header));
+    if(next != type || replayOffset + sizeof(header) + header.size > replayLog.size()){
+        // The controller took a different path than when it was recorded
+        ROS_ERROR("nextRecord() | diverged at record %llu: the controller read %s, the log has %s",
+            (unsigned long long) replayRecords, recordNames[type], recordNames[std::min<int>(next, REPLAY_TYPES)]);
+        replayEnded = true;
+        replayDiverged = true;
+        return nullptr;
+    }
+
+    const uint8_t *payload = &replayLog[replayOffset + sizeof(header)];
+    replayOffset += sizeof(header) + header.size;
+    replayRecords++;
+    size = header.size;
+    return payload;
+}
+
+bool replayInput(ReplayRecordType type, void *data, uint32_t size){
+    if(!replayOn){
+        return false;
+    }
+    uint32_t recorded;
+    const uint8_t *payload = nextRecord(type, recorded);
+    if(payload != nullptr && size > 0){
+        std::memcpy(data, payload, std::min(size, recorded));
+    }
+    return true;
+}
+
+static ReplayReader replayReader(ReplayRecordType type){
+    uint32_t size = 0;
+    const uint8_t *payload = nextRecord(type, size);
+    return {payload, payload + size};
+}
+
+void replayMessage(sensor_msgs::LaserScan &msg){
+    ReplayReader in = replayReader(REPLAY_SCAN);
+    uint64_t stamp = 0;
+    in.get(stamp);
+    msg.header.stamp.fromNSec(stamp);
+    in.get(msg.angle_min);
+    in.get(msg.angle_max);
+    in.get(msg.angle_increment);
+    in.get(msg.time_increment);
+    in.get(msg.scan_time);
+    in.get(msg.range_min);
+    in.get(msg.range_max);
+    in.getArray(msg.ranges);
+    in.getArray(msg.intensities);
+}
+
+void replayMessage(nav_msgs::Odometry &msg){
+    ReplayReader in = replayReader(REPLAY_ODOM);
+    uint64_t stamp = 0;
+    in.get(stamp);
+    msg.header.stamp.fromNSec(stamp);
+    getPose(in, msg.pose.pose);
+    in.get(msg.twist.twist.linear.x);
+    in.get(msg.twist.twist.angular.z);
+}
+
+void replayMessage(nav_msgs::OccupancyGrid &msg){
+    ReplayReader in = replayReader(REPLAY_MAP);
+    uint64_t stamp = 0;
+    in.get(stamp);
+    msg.header.stamp.fromNSec(stamp);
+    in.get(msg.info.resolution);
+    in.get(msg.info.width);
+    in.get(msg.info.height);
+    getPose(in, msg.info.origin);
+    in.getArray(msg.data);
+    msg.data.resize((size_t) msg.info.width * msg.info.height, -1);
+}
+
+void replayMessage(kobuki_msgs::BumperEvent &msg){
+    ReplayReader in = replayReader(REPLAY_BUMPER);
+    in.get(msg.bumper);
+    in.get(msg.state);
+}
+
+#pragma endregion
+
+void noteCommand(const geometry_msgs::Twist &cmd){
+    double command[2] = {cmd.linear.x, cmd.angular.z};
+    if(!replayOn){
+        recordInput(REPLAY_COMMAND, command, sizeof(command));
+        return;
+    }
+
+    double recorded[2];
+    uint32_t size = 0;
+    const uint8_t *payload = nextRecord(REPLAY_COMMAND, size);
+    if(payload == nullptr || size != sizeof(recorded)){
+        return;
+    }
+    std::memcpy(recorded, payload, sizeof(recorded));
+
+    commandsCompared++;
+    if(std::memcmp(command, recorded, sizeof(command)) != 0){
+        if(commandMismatches < (uint64_t) replayMismatchReports){
+            ROS_WARN("noteCommand() | command %llu differs: %.17g/%.17g, recorded %.17g/%.17g",
+                (unsigned long long) commandsCompared, command[0], command[1], recorded[0], recorded[1]);
+        }
+        commandMismatches++;
+    }
+}
+
+int finishReplay(){
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+    size_t left = replayLog.size() - replayOffset;
+    ROS_INFO("finishReplay() | %llu records, %llu commands compared, %llu differ, in %.2f s",
+        (unsigned long long) replayRecords, (unsigned long long) commandsCompared, (unsigned long long) commandMismatches, seconds);
+    if(left > 0 && !replayDiverged){
+        ROS_ERROR("finishReplay() | the controller stopped with %zu bytes of the log left", left);
+    }
+    replayOn = false;
+    return replayDiverged || commandMismatches > 0 || left > 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#ifndef replayHeader
+#define replayHeader
+
+#include "common.h"
+#include <nav_msgs/OccupancyGrid.h>
+
+// Deterministic record and replay of everything the control thread consumes. While recording,
+// each input is appended to a binary log in the order the control thread reads it:
+//  - every spinSensors() call, followed by the scan, odometry, map and bumper messages it dispatched,
+//  - clock reads (clockNow()), controlOk(), cancel tokens, arbiter preemption, the joystick and
+//    the cached map <- odom transform, i.e. everything another thread can change under it,
+//  - every command publishVelocity() produces, as the reference output.
+// `contest1 --replay <log>` runs the same control code without a ROS master, reading those inputs
+// back instead, sleeping never, and compares each command with the recorded one bit for bit.
+// Reads from other threads (arbiter, watchdog, timers) are never recorded.
+//
+// Log: ReplayLogHeader, then records of ReplayRecordHeader + payload.
+
+enum ReplayRecordType : uint8_t {
+    REPLAY_SPIN,
+    REPLAY_SCAN,
+    REPLAY_ODOM,
+    REPLAY_MAP,
+    REPLAY_BUMPER,
+    REPLAY_CLOCK,
+    REPLAY_OK,
+    REPLAY_CANCEL,
+    REPLAY_PREEMPTED,
+    REPLAY_JOYSTICK,
+    REPLAY_TRANSFORM,
+    REPLAY_COMMAND,
+    REPLAY_TYPES
+};
+
+struct ReplayLogHeader{
+    char magic[8];      // "MIE443RP"
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct ReplayRecordHeader{
+    uint8_t type;       // ReplayRecordType
+    uint8_t reserved[3];
+    uint32_t size;      // Payload bytes
+};
+
+// Call from the control thread, which is the only one recorded
+bool startRecording(const char *path);
+void stopRecording();
+bool recording();
+
+bool startReplay(const char *path);
+// Prints the comparison, returns the process exit code: 0 if every command matched
+int finishReplay();
+bool replaying();
+
+// Appends an input if recording and called from the control thread
+void recordInput(ReplayRecordType type, const void *data, uint32_t size);
+
+// In replay, fills data from the next record, which must be of this type, and returns true.
+// Once the log has run out or diverged data is left as it is, so callers preset the value that
+// winds the controller down.
+bool replayInput(ReplayRecordType type, void *data, uint32_t size);
+
+// Type of the next record in replay, REPLAY_TYPES once the log has run out
+ReplayRecordType peekReplay();
+
+void recordMessage(const sensor_msgs::LaserScan &msg);
+void recordMessage(const nav_msgs::Odometry &msg);
+void recordMessage(const nav_msgs::OccupancyGrid &msg);
+void recordMessage(const kobuki_msgs::BumperEvent &msg);
+
+void replayMessage(sensor_msgs::LaserScan &msg);
+void replayMessage(nav_msgs::Odometry &msg);
+void replayMessage(nav_msgs::OccupancyGrid &msg);
+void replayMessage(kobuki_msgs::BumperEvent &msg);
+
+// Records the command while recording, checks it against the recorded one in replay
+void noteCommand(const geometry_msgs::Twist &cmd);
+
+#endif
@@ -0,0 +1,90 @@
+#include "sensorMailbox.h"
+#include "laser.h"
+#include "bumper.h"
+#include "movement.h"
+#include "distanceField.h"
+
+#include <ros/callback_queue.h>
+
+#include <memory>
+
+uint32_t bumperQueueSize = 100;     // Bumper edges kept between spins
+
+LatestMailbox<sensor_msgs::LaserScan> scanMailbox;
+LatestMailbox<nav_msgs::Odometry> odomMailbox;
+LatestMailbox<nav_msgs::OccupancyGrid> mapMailbox;
+EdgeMailbox<kobuki_msgs::BumperEvent> bumperMailbox;
+
+static std::vector<MailboxBase *> mailboxes;
+static ros::CallbackQueue sensorQueue;
+static std::unique_ptr<ros::AsyncSpinner> sensorSpinner;
+
+void registerMailbox(MailboxBase *mailbox){
+    mailboxes.push_back(mailbox);
+}
+
+void subscribeSensors(ros::NodeHandle &nh){
+    ros::NodeHandle sensorNh(nh);
+    sensorNh.setCallbackQueue(&sensorQueue);
+
+    // Bumpers first so a hit is handled before the scan and pose that came with it
+    bumperMailbox.subscribe(sensorNh, "mobile_base/events/bumper", bumperQueueSize, &bumperCallback);
+    odomMailbox.subscribe(sensorNh, "odom", &odomCallback);
+    scanMailbox.subscribe(sensorNh, "scan", &laserCallback);
+    mapMailbox.subscribe(sensorNh, "map", &mapCallback);
+
+    sensorSpinner.reset(new ros::AsyncSpinner(1, &sensorQueue));
+    sensorSpinner->start();
+}
+
+void stopSensors(){
+    if(sensorSpinner){
+        sensorSpinner->stop();
+        sensorSpinner.reset();
+    }
+    bumperMailbox.subscriber.shutdown();
+    odomMailbox.subscriber.shutdown();
+    scanMailbox.subscriber.shutdown();
+    mapMailbox.subscriber.shutdown();
+}
+
+template<class M> static void replayMailbox(void (*handler)(const typename M::ConstPtr&)){
+    boost::shared_ptr<M> msg(new M());
+    replayMessage(*msg);
+    handler(msg);
+}
+
+static void replaySpin(){
+    replayInput(REPLAY_SPIN, nullptr, 0);
+    while(true){
+        switch(peekReplay()){
+            case REPLAY_SCAN: replayMailbox<sensor_msgs::LaserScan>(&laserCallback); break;
+            case REPLAY_ODOM: replayMailbox<nav_msgs::Odometry>(&odomCallback); break;
+            case REPLAY_MAP: replayMailbox<nav_msgs::OccupancyGrid>(&mapCallback); break;
+            case REPLAY_BUMPER: replayMailbox<kobuki_msgs::BumperEvent>(&bumperCallback); break;
+            default: return;
+        }
+    }
+}
+
+void spinSensors(){
+    if(replaying()){
+        replaySpin();
+        return;
+    }
+    recordInput(REPLAY_SPIN, nullptr, 0);
+    ros::spinOnce();
+    for(MailboxBase *mailbox : mailboxes){
+        mailbox->dispatch();
+    }
+}
+
+bool controlOk(){
+    uint8_t ok = 0;     // Stop once the log runs out
+    if(replayInput(REPLAY_OK, &ok, sizeof(ok))){
+        return ok;
+    }
+    ok = ros::ok();
+    recordInput(REPLAY_OK, &ok, sizeof(ok));
+    return ok;
+}
@@ -0,0 +1,134 @@
+#ifndef sensorMailboxHeader
+#define sensorMailboxHeader
+
+#include "common.h"
+#include "clock.h"
+#include "replay.h"
+#include <nav_msgs/OccupancyGrid.h>
+
+#include <atomic>
+#include <mutex>
+
+// Sensor subscriptions that hand controllers the freshest data. The ROS callback runs on the
+// sensor spinner thread and only stores the message pointer, so arrival times and counts are
+// taken when a message arrives rather than when the control loop next spins. The processing
+// callback (laserCallback etc.) still runs on the control thread, from spinSensors().
+// Stream topics are subscribed with a queue of one, so roscpp drops superseded messages before
+// they are ever deserialized, and a mailbox that received several messages between spins still
+// processes only the newest. Event topics keep every message so no bumper edge is lost.
+
+struct MailboxBase{
+    virtual ~MailboxBase(){}
+    virtual void dispatch() = 0;
+};
+
+void registerMailbox(MailboxBase *mailbox);
+
+// Newest sample only
+template<class M> struct LatestMailbox : MailboxBase{
+    typedef void (*Handler)(const typename M::ConstPtr&);
+
+    void subscribe(ros::NodeHandle &nh, const std::string &topic, Handler handler){
+        this->handler = handler;
+        subscriber = nh.subscribe(topic, 1, &LatestMailbox<M>::receive, this, ros::TransportHints().tcpNoDelay());
+        registerMailbox(this);
+    }
+
+    void receive(const typename M::ConstPtr &msg){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = msg;
+            fresh = true;
+        }
+        receivedNs.store(clockLiveNs(), std::memory_order_relaxed);
+        received.store(received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void dispatch(){
+        typename M::ConstPtr msg;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!fresh) return;
+            fresh = false;
+            msg = latest;
+        }
+        recordMessage(*msg);
+        handler(msg);
+    }
+
+    // Seconds since the newest sample arrived, infinite before the first. Safe from any thread.
+    double age() const{
+        uint64_t at = receivedNs.load(std::memory_order_relaxed);
+        return at == 0 ? std::numeric_limits<double>::infinity() : (clockLiveNs() - at) * 1e-9;
+    }
+
+    ros::Subscriber subscriber;
+    Handler handler = nullptr;
+    std::mutex mutex;
+    typename M::ConstPtr latest;
+    bool fresh = false;
+    std::atomic<uint64_t> receivedNs{0};
+    std::atomic<uint64_t> received{0};
+};
+
+// Every sample, in arrival order
+template<class M> struct EdgeMailbox : MailboxBase{
+    typedef void (*Handler)(const typename M::ConstPtr&);
+
+    void subscribe(ros::NodeHandle &nh, const std::string &topic, uint32_t queueSize, Handler handler){
+        this->handler = handler;
+        subscriber = nh.subscribe(topic, queueSize, &EdgeMailbox<M>::receive, this, ros::TransportHints().tcpNoDelay());
+        registerMailbox(this);
+    }
+
+    void receive(const typename M::ConstPtr &msg){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(msg);
+        }
+        receivedNs.store(clockLiveNs(), std::memory_order_relaxed);
+    }
+
+    void dispatch(){
+        // Handlers may take a while; anything arriving meanwhile waits for the next spin
+        std::vector<typename M::ConstPtr> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(pending);
+        }
+        for(const typename M::ConstPtr &msg : batch){
+            recordMessage(*msg);
+            handler(msg);
+        }
+    }
+
+    double age() const{
+        uint64_t at = receivedNs.load(std::memory_order_relaxed);
+        return at == 0 ? std::numeric_limits<double>::infinity() : (clockLiveNs() - at) * 1e-9;
+    }
+
+    ros::Subscriber subscriber;
+    Handler handler = nullptr;
+    std::mutex mutex;
+    std::vector<typename M::ConstPtr> pending;
+    std::atomic<uint64_t> receivedNs{0};
+};
+
+extern LatestMailbox<sensor_msgs::LaserScan> scanMailbox;
+extern LatestMailbox<nav_msgs::Odometry> odomMailbox;
+extern LatestMailbox<nav_msgs::OccupancyGrid> mapMailbox;
+extern EdgeMailbox<kobuki_msgs::BumperEvent> bumperMailbox;
+
+// Subscribes every mailbox on the sensor queue and starts the thread that receives into them
+void subscribeSensors(ros::NodeHandle &nh);
+void stopSensors();
+
+// Replaces ros::spinOnce() in the control code: services the global queue, then runs the processing
+// callback of every mailbox that received something. In replay it runs the callbacks on the
+// messages the recorded spin dispatched instead.
+void spinSensors();
+
+// Replaces ros::ok() in the control loops, recorded like every other input
+bool controlOk();
+
+#endif
@@ -0,0 +1,91 @@
+#include "speedGovernor.h"
+#include "velocityProfiler.h"
+#include "distanceField.h"
+#include "obstacleMemory.h"
+#include "contactLayer.h"
+#include "clock.h"
+
+#include <atomic>
+
+float governorLookahead = 1.5;      // Metres of predicted path checked for clearance
+float governorPathStep = 0.1;       // Spacing of the clearance samples along the path (m)
+float governorLateralAccel = 0.6;   // m/s^2
+float governorMemoryHalfArc = 15;   // Degrees either side of the predicted heading checked in the obstacle memory
+double governorSnapshotLifetime = 0.5;     // s the straight-ahead snapshot stays valid, 7 cm at teleop top speed
+
+static std::atomic<float> forwardSnapshot{0};
+static std::atomic<uint64_t> forwardSnapshotNs{0};
+
+float pathClearance(float linearCmd, float angularCmd, float maxDistance){
+    if(!esdfReady() && contactLayerEmpty()){
+        return maxDistance;
+    }
+
+    // Heading change per metre of travel; an in-place turn is checked as a straight line
+    float curvature = std::abs(linearCmd) > 1e-3f ? angularCmd / linearCmd : 0;
+    float direction = linearCmd < 0 ? -1 : 1;
+    float heading = Deg2Rad(yaw);
+
+    // Already inside the footprint of a mapped wall (map noise, or just after a bumper hit):
+    // only motion that gets closer still counts as blocked
+    float startClearance = std::min(esdfDistance(posX, posY), contactClearance(posX, posY));
+
+    for(float s = governorPathStep; s <= maxDistance; s += governorPathStep){
+        float theta = heading + curvature * s;
+        float px, py;
+        if(std::abs(curvature) < 1e-3f){
+            px = posX + direction * s * std::cos(heading);
+            py = posY + direction * s * std::sin(heading);
+        }
+        else {
+            px = posX + direction * (std::sin(theta) - std::sin(heading)) / curvature;
+            py = posY - direction * (std::cos(theta) - std::cos(heading)) / curvature;
+        }
+
+        float d = std::min(esdfDistance(px, py), contactClearance(px, py));
+        if(d < robotRadius && d < startClearance - 0.5f * governorPathStep){
+            return s - governorPathStep;
+        }
+    }
+    return maxDistance;
+}
+
+float governedSpeedLimit(float linearCmd, float angularCmd){
+    float limit = maxLinear;
+
+    // 1. Stopping distance. distances.min measures from the sensor like a free distance does,
+    //    so the two are directly comparable.
+    float clearance = std::min(distances.min, pathClearance(linearCmd, angularCmd, governorLookahead) + brakingStopMargin);
+
+    // Remembered obstacles in the direction the arc is heading half a metre on, which is
+    // outside the fan when turning
+    if(linearCmd > 0){
+        float curvature = angularCmd / std::max(linearCmd, minLinear);
+        float bearing = Rad2Deg(0.5f * curvature);
+        float nearest = nearestObstacleInArc(bearing - governorMemoryHalfArc, bearing + governorMemoryHalfArc);
+        clearance = std::min(clearance, nearest - robotRadius + brakingStopMargin);
+    }
+    limit = std::min(limit, brakingSpeedLimit(clearance));
+
+    // 2./3. Heading change over the next metre
+    float curvature = std::abs(angularCmd) / std::max(std::abs(linearCmd), minLinear);
+    if(curvature > 1e-3f){
+        limit = std::min(limit, (float) Deg2Rad(maxAngular) / curvature);
+        limit = std::min(limit, std::sqrt(governorLateralAccel / curvature));
+    }
+
+    return limit;
+}
+
+void publishGovernedSnapshot(){
+    forwardSnapshot.store(governedSpeedLimit(maxLinear, 0), std::memory_order_relaxed);
+    forwardSnapshotNs.store(clockLiveNs(), std::memory_order_release);
+}
+
+float governedForwardSnapshot(){
+    uint64_t at = forwardSnapshotNs.load(std::memory_order_acquire);
+    if(at == 0 || (clockLiveNs() - at) * 1e-9 > governorSnapshotLifetime){
+        return 0;
+    }
+    return forwardSnapshot.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,26 @@
+#ifndef speedGovernorHeader
+#define speedGovernorHeader
+
+#include "common.h"
+
+// Safe top speed for a command, from three limits:
+//  1. stopping distance: the robot must be able to brake to a stop inside the free distance
+//     along the arc it is about to drive (scan cone and distance field),
+//  2. turn rate: the heading change per metre (curvature) times speed may not exceed maxAngular,
+//  3. lateral acceleration: v^2 * curvature stays under governorLateralAccel.
+// publishVelocity() applies it to every command; controllers can also query it to scale their
+// own setpoints.
+
+float governedSpeedLimit(float linearCmd, float angularCmd);
+
+// Straight-ahead limit for commands issued off the control thread (teleop), which cannot read
+// the scan or the distance field. publishVelocity() refreshes it every control tick; a snapshot
+// older than governorSnapshotLifetime reads as zero, so nothing drives forward blind.
+void publishGovernedSnapshot();
+float governedForwardSnapshot();
+
+// Free distance (m) along the arc traced by (linearCmd, angularCmd) before the robot's footprint
+// would touch a mapped obstacle, looking at most maxDistance ahead
+float pathClearance(float linearCmd, float angularCmd, float maxDistance);
+
+#endif
@@ -0,0 +1,71 @@
+#include "tfCache.h"
+#include "distanceField.h"
+#include "replay.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tf/transform_listener.h>
+
+float tfCacheRate = 10;         // Hz
+
+static std::thread tfThread;
+static std::atomic<bool> tfRunning{false};
+static std::mutex tfMutex;
+static CachedTransform tfLatest = {false, 0, 0, 0, 0};
+
+static void tfCacheLoop(){
+    tf::TransformListener listener;
+    ros::Rate rate(tfCacheRate);
+
+    while(tfRunning && ros::ok()){
+        tf::StampedTransform transform;
+        try{
+            if(listener.waitForTransform("map", "odom", ros::Time(0), ros::Duration(1.0 / tfCacheRate))){
+                listener.lookupTransform("map", "odom", ros::Time(0), transform);
+
+                std::lock_guard<std::mutex> lock(tfMutex);
+                tfLatest.valid = true;
+                tfLatest.x = transform.getOrigin().x();
+                tfLatest.y = transform.getOrigin().y();
+                tfLatest.yaw = tf::getYaw(transform.getRotation());
+                tfLatest.stamp = transform.stamp_.toSec();
+            }
+        }
+        catch(tf::TransformException &ex){
+            ROS_WARN_THROTTLE(5, "tfCacheLoop() | map <- odom lookup failed: %s", ex.what());
+        }
+        rate.sleep();
+    }
+}
+
+void startTfCache(){
+    if(tfRunning) return;
+    tfRunning = true;
+    tfThread = std::thread(tfCacheLoop);
+}
+
+void stopTfCache(){
+    tfRunning = false;
+    if(tfThread.joinable()) tfThread.join();
+}
+
+CachedTransform cachedOdomToMap(){
+    CachedTransform transform = {false, 0, 0, 0, 0};
+    if(replayInput(REPLAY_TRANSFORM, &transform, sizeof(transform))){
+        return transform;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tfMutex);
+        transform = tfLatest;
+    }
+    recordInput(REPLAY_TRANSFORM, &transform, sizeof(transform));
+    return transform;
+}
+
+void applyCachedOdomToMap(){
+    CachedTransform transform = cachedOdomToMap();
+    if(transform.valid){
+        setOdomToMap(transform.x, transform.y, transform.yaw);
+    }
+}
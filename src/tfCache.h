@@ -0,0 +1,28 @@
+#ifndef tfCacheHeader
+#define tfCacheHeader
+
+#include "common.h"
+
+// Latest map <- odom transform, looked up on a background thread so no callback ever waits on
+// tf. Callbacks read the cached value, which is at most one refresh period old; the map <- odom
+// correction from gmapping changes slowly, so this costs nothing in accuracy.
+
+struct CachedTransform{
+    bool valid;
+    float x;        // Origin of odom in the map frame (m)
+    float y;
+    float yaw;      // rad
+    double stamp;
+};
+
+void startTfCache();
+
+void stopTfCache();
+
+CachedTransform cachedOdomToMap();
+
+// Hand the latest cached transform to the distance field and contact layer. Call from the
+// thread that queries them.
+void applyCachedOdomToMap();
+
+#endif
@@ -0,0 +1,138 @@
+#include "velocityProfiler.h"
+#include "speedGovernor.h"
+#include "commandTrace.h"
+#include "commandArbiter.h"
+#include "joystick.h"
+#include "clock.h"
+#include "replay.h"
+
+float maxLinearAccel = 0.5;     // m/s^2
+float maxLinearDecel = 0.8;     // m/s^2
+float maxLinearJerk = 2.0;      // m/s^3
+float maxAngularAccel = 3.0;    // rad/s^2
+float maxAngularDecel = 4.0;    // rad/s^2
+float maxAngularJerk = 12.0;    // rad/s^3
+
+float emergencyLinearDecel = 1.5;   // m/s^2, used without a jerk limit when over the braking limit
+float brakingStopMargin = 0.15;     // Clearance left once stopped (m)
+float brakingCreepSpeed = 0.05;     // Never cap below this while clearance exceeds the margin
+float profilerMaxStep = 0.1;        // Longer gaps between commands restart from the last state
+double commandLifetime = 0.25;      // s a submitted command stays valid if the caller stops submitting
+
+AxisProfile linearProfile = {0, 0};
+AxisProfile angularProfile = {0, 0};
+double lastProfileTime = -1;
+
+void resetVelocityProfiler(){
+    linearProfile = {0, 0};
+    angularProfile = {0, 0};
+    lastProfileTime = -1;
+}
+
+float brakingSpeedLimit(float clearance){
+    float room = clearance - brakingStopMargin;
+    if(std::isnan(room)){
+        return brakingCreepSpeed;
+    }
+    if(room <= 0){
+        return 0;
+    }
+    return std::max(brakingCreepSpeed, std::sqrt(2 * maxLinearDecel * room));
+}
+
+float stepAxisProfile(AxisProfile &axis, float target, float maxAccel, float maxDecel, float maxJerk, float dt){
+    float error = target - axis.velocity;
+    if(std::abs(error) < 1e-4){
+        axis.velocity = target;
+        axis.accel = 0;
+        return axis.velocity;
+    }
+
+    // Slowing down (towards zero or through it) may use the larger deceleration limit
+    bool slowing = std::abs(target) < std::abs(axis.velocity) || target * axis.velocity < 0;
+    float accelLimit = slowing ? maxDecel : maxAccel;
+
+    // Largest acceleration that can still be ramped back to zero as the error closes
+    float desired = std::min(accelLimit, std::sqrt(2 * maxJerk * std::abs(error)));
+    if(error < 0){
+        desired = -desired;
+    }
+
+    float jerkStep = maxJerk * dt;
+    axis.accel += std::max(-jerkStep, std::min(jerkStep, desired - axis.accel));
+
+    float next = axis.velocity + axis.accel * dt;
+    if((target - next) * error <= 0){
+        next = target;      // Would overshoot
+        axis.accel = 0;
+    }
+    axis.velocity = next;
+    return axis.velocity;
+}
+
+static void sendVelocity(const geometry_msgs::Twist &cmd, CommandSource source, const CommandTag &tag, ros::Publisher &vel_pub){
+    noteCommand(cmd);
+    if(replaying()){
+        return;     // Compared with the recorded command instead of sent
+    }
+    if(arbiterRunning()){
+        submitCommand(source, cmd, commandLifetime, tag);
+    }
+    else {
+        vel_pub.publish(cmd);
+        traceCommand(tag, clockNow());
+    }
+}
+
+void publishVelocity(const geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+    CommandTag tag = currentCommandTag();
+    CommandSource source = behaviorSource(tag.behavior);
+    if(arbiterPreempted(source)){
+        // A higher priority source is driving; start from rest once it lets go
+        resetVelocityProfiler();
+    }
+
+    double now = clockNow();
+    float dt = lastProfileTime < 0 ? 0 : now - lastProfileTime;
+    lastProfileTime = now;
+
+    if(dt > profilerMaxStep){
+        // Nothing was commanded for a while, the base has settled on the last output
+        linearProfile.accel = 0;
+        angularProfile.accel = 0;
+        dt = profilerMaxStep;
+    }
+    dt = std::max(dt, 0.0f);
+
+    float targetLinear = vel.linear.x;
+    float targetAngular = vel.angular.z;
+    blendJoystick(tag.behavior, targetLinear, targetAngular);
+
+    // Cap at the governed speed (braking distance along the predicted path, curvature). Over the
+    // limit the jerk limit is dropped so the robot sheds speed immediately.
+    float brakeLimit = governedSpeedLimit(targetLinear, targetAngular);
+    publishGovernedSnapshot();
+    if(targetLinear > brakeLimit){
+        targetLinear = brakeLimit;
+    }
+    if(linearProfile.velocity > brakeLimit){
+        linearProfile.velocity = std::max(brakeLimit, linearProfile.velocity - emergencyLinearDecel * dt);
+        linearProfile.accel = -emergencyLinearDecel;
+    }
+    else {
+        stepAxisProfile(linearProfile, targetLinear, maxLinearAccel, maxLinearDecel, maxLinearJerk, dt);
+    }
+
+    stepAxisProfile(angularProfile, targetAngular, maxAngularAccel, maxAngularDecel, maxAngularJerk, dt);
+
+    geometry_msgs::Twist profiled;
+    profiled.linear.x = linearProfile.velocity;
+    profiled.angular.z = angularProfile.velocity;
+    sendVelocity(profiled, source, tag, vel_pub);
+}
+
+void stopVelocity(ros::Publisher &vel_pub){
+    CommandTag tag = currentCommandTag();
+    resetVelocityProfiler();
+    sendVelocity(geometry_msgs::Twist(), behaviorSource(tag.behavior), tag, vel_pub);
+}
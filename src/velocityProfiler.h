@@ -0,0 +1,36 @@
+#ifndef velocityProfilerHeader
+#define velocityProfilerHeader
+
+#include "common.h"
+
+// Every velocity command goes through publishVelocity() instead of vel_pub.publish(). The
+// requested twist is treated as a setpoint: the published command approaches it under
+// acceleration and jerk limits, and forward speed is capped so the robot can always brake
+// to a stop within the clearance ahead. In shared control the joystick is blended into the
+// setpoint first (joystick.h), so the operator's share is clearance-limited too. The result
+// is submitted to the command arbiter under the current behavior's source, or published
+// directly if the arbiter is not running.
+
+extern float maxLinearAccel, maxLinearDecel;
+extern float maxAngularAccel, maxAngularDecel;
+extern float brakingStopMargin;
+
+struct AxisProfile{
+    float velocity;
+    float accel;
+};
+
+void publishVelocity(const geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+
+// Ends a motion: forgets the profiled state and commands a true zero at once instead of
+// profiling towards it, so nothing of the last speed outlives the primitive that set it
+void stopVelocity(ros::Publisher &vel_pub);
+
+// Forget the profiled state, e.g. after a bumper hit when the base has physically stopped
+void resetVelocityProfiler();
+
+float brakingSpeedLimit(float clearance);
+
+float stepAxisProfile(AxisProfile &axis, float target, float maxAccel, float maxDecel, float maxJerk, float dt);
+
+#endif
@@ -0,0 +1,261 @@
+#include "visualization.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/PointField.h>
+
+float markerPublishRate = 2;        // Hz
+size_t markerQueueLimit = 256;      // Oldest kept markers are dropped beyond this
+float scenePathStep = 0.1;          // Spacing of the samples on a drawn arc (s)
+
+static DebugScene scenes[2];
+static int backScene = 0;           // Written by the control thread
+static std::mutex sceneMutex;       // Guards backScene and the back buffer
+static std::thread sceneThread;
+static std::atomic<bool> sceneRunning{false};
+static std::atomic<bool> sceneSubscribed{false};
+
+// One-off markers (bumper hits) are kept whether or not anyone is watching and resent whenever
+// they change or a new subscriber connects, so a late rviz still sees every hit. Guarded by sceneMutex.
+static std::vector<visualization_msgs::Marker> keptMarkers;
+static bool keptMarkersChanged = false;
+
+static ros::Publisher candidate_pub;
+static ros::Publisher frontier_pub;
+
+bool sceneWanted(){
+    return sceneSubscribed.load(std::memory_order_relaxed);
+}
+
+static void copyGrid(const PointGrid &grid, std::vector<std::array<float, 2>> &points){
+    points.resize(gridSize(grid));
+    for(size_t i = 0; i < gridSize(grid); i++){
+        points[i] = {gridCell(grid, i).x, gridCell(grid, i).y};
+    }
+}
+
+void setSceneCandidates(const PointGrid &candidates){
+    if(!sceneWanted()) return;
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    copyGrid(candidates, scenes[backScene].candidates);
+    scenes[backScene].dirty[SCENE_CANDIDATES] = true;
+}
+
+void setSceneTarget(float x, float y){
+    if(!sceneWanted()) return;
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    scenes[backScene].target = {x, y};
+    scenes[backScene].dirty[SCENE_TARGET] = true;
+}
+
+void setSceneVisited(const PointGrid &visited){
+    if(!sceneWanted()) return;
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    copyGrid(visited, scenes[backScene].visited);
+    scenes[backScene].dirty[SCENE_VISITED] = true;
+}
+
+void setSceneFrontiers(const nav_msgs::OccupancyGrid &map){
+    if(!sceneWanted()) return;
+
+    int width = map.info.width;
+    int height = map.info.height;
+    float resolution = map.info.resolution;
+
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    std::vector<std::array<float, 2>> &frontiers = scenes[backScene].frontiers;
+    frontiers.clear();
+    for(int y = 1; y + 1 < height; y++){
+        for(int x = 1; x + 1 < width; x++){
+            int i = y * width + x;
+            if(map.data[i] != 0) continue;
+            if(map.data[i - 1] < 0 || map.data[i + 1] < 0 || map.data[i - width] < 0 || map.data[i + width] < 0){
+                frontiers.push_back({(float) map.info.origin.position.x + (x + 0.5f) * resolution,
+                                     (float) map.info.origin.position.y + (y + 0.5f) * resolution});
+            }
+        }
+    }
+    scenes[backScene].dirty[SCENE_FRONTIERS] = true;
+}
+
+void setScenePath(const std::vector<std::array<float, 2>> &path){
+    if(!sceneWanted()) return;
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    scenes[backScene].path = path;
+    scenes[backScene].dirty[SCENE_PATH] = true;
+}
+
+void setScenePathArc(float posX, float posY, float yawDeg, float linear, float angular, float horizon){
+    if(!sceneWanted()) return;
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    std::vector<std::array<float, 2>> &path = scenes[backScene].path;
+    path.clear();
+
+    float x = posX, y = posY, theta = Deg2Rad(yawDeg);
+    path.push_back({x, y});
+    for(float t = 0; t < horizon; t += scenePathStep){
+        x += linear * std::cos(theta + 0.5f * angular * scenePathStep) * scenePathStep;
+        y += linear * std::sin(theta + 0.5f * angular * scenePathStep) * scenePathStep;
+        theta += angular * scenePathStep;
+        path.push_back({x, y});
+    }
+    scenes[backScene].dirty[SCENE_PATH] = true;
+}
+
+void queueMarker(const visualization_msgs::Marker &marker){
+    std::lock_guard<std::mutex> lock(sceneMutex);
+    keptMarkersChanged = true;
+
+    // A newer marker with the same namespace and id replaces the kept one
+    for(visualization_msgs::Marker &kept : keptMarkers){
+        if(kept.id == marker.id && kept.ns == marker.ns){
+            kept = marker;
+            return;
+        }
+    }
+    if(keptMarkers.size() >= markerQueueLimit){
+        keptMarkers.erase(keptMarkers.begin());
+    }
+    keptMarkers.push_back(marker);
+}
+
+#pragma region Publishing
+
+static sensor_msgs::PointCloud2 toCloud(const std::vector<std::array<float, 2>> &points, const char *frame){
+    sensor_msgs::PointCloud2 cloud;
+    cloud.header.stamp = ros::Time::now();
+    cloud.header.frame_id = frame;
+    cloud.height = 1;
+    cloud.width = points.size();
+
+    const char *names[3] = {"x", "y", "z"};
+    for(int k = 0; k < 3; k++){
+        sensor_msgs::PointField field;
+        field.name = names[k];
+        field.offset = 4 * k;
+        field.datatype = sensor_msgs::PointField::FLOAT32;
+        field.count = 1;
+        cloud.fields.push_back(field);
+    }
+    cloud.is_bigendian = false;
+    cloud.point_step = 12;
+    cloud.row_step = cloud.point_step * cloud.width;
+    cloud.is_dense = true;
+
+    cloud.data.resize(cloud.row_step);
+    for(size_t i = 0; i < points.size(); i++){
+        float xyz[3] = {points[i][0], points[i][1], 0};
+        std::memcpy(&cloud.data[i * cloud.point_step], xyz, sizeof(xyz));
+    }
+    return cloud;
+}
+
+static visualization_msgs::Marker layerMarker(const char *ns, int type, float scale, float r, float g, float b){
+    visualization_msgs::Marker marker;
+    marker.header.stamp = ros::Time::now();
+    marker.header.frame_id = "odom";
+    marker.ns = ns;
+    marker.id = 0;
+    marker.type = type;
+    marker.action = visualization_msgs::Marker::ADD;
+    marker.pose.orientation.w = 1.0;
+    marker.scale.x = scale;
+    marker.scale.y = scale;
+    marker.scale.z = scale;
+    marker.color.a = 1.0;
+    marker.color.r = r;
+    marker.color.g = g;
+    marker.color.b = b;
+    return marker;
+}
+
+static void addPoints(visualization_msgs::Marker &marker, const std::vector<std::array<float, 2>> &points){
+    marker.points.resize(points.size());
+    for(size_t i = 0; i < points.size(); i++){
+        marker.points[i].x = points[i][0];
+        marker.points[i].y = points[i][1];
+        marker.points[i].z = 0;
+    }
+}
+
+static void publishScene(DebugScene &scene){
+    visualization_msgs::MarkerArray &array = scene.markers;
+
+    if(scene.dirty[SCENE_TARGET]){
+        visualization_msgs::Marker marker = layerMarker("scene_target", visualization_msgs::Marker::SPHERE, 0.2, 1.0, 0.0, 0.0);
+        marker.pose.position.x = scene.target[0];
+        marker.pose.position.y = scene.target[1];
+        array.markers.push_back(marker);
+    }
+    if(scene.dirty[SCENE_VISITED]){
+        visualization_msgs::Marker marker = layerMarker("scene_visited", visualization_msgs::Marker::POINTS, 0.1, 0.0, 0.4, 1.0);
+        addPoints(marker, scene.visited);
+        array.markers.push_back(marker);
+    }
+    if(scene.dirty[SCENE_PATH]){
+        visualization_msgs::Marker marker = layerMarker("scene_path", visualization_msgs::Marker::LINE_STRIP, 0.03, 1.0, 0.6, 0.0);
+        addPoints(marker, scene.path);
+        array.markers.push_back(marker);
+    }
+
+    if(!array.markers.empty()){
+        marker_pub.publish(array);
+    }
+    if(scene.dirty[SCENE_CANDIDATES]){
+        candidate_pub.publish(toCloud(scene.candidates, "odom"));
+    }
+    if(scene.dirty[SCENE_FRONTIERS]){
+        frontier_pub.publish(toCloud(scene.frontiers, "map"));
+    }
+
+    array.markers.clear();
+    std::fill(scene.dirty, scene.dirty + SCENE_LAYERS, false);
+}
+
+static void visualizationLoop(){
+    ros::Rate rate(markerPublishRate);
+
+    uint32_t markerSubscribers = 0;
+    while(sceneRunning && ros::ok()){
+        uint32_t subscribers = marker_pub.getNumSubscribers();
+        bool newSubscriber = subscribers > markerSubscribers;
+        markerSubscribers = subscribers;
+        sceneSubscribed = subscribers > 0 || candidate_pub.getNumSubscribers() > 0
+            || frontier_pub.getNumSubscribers() > 0;
+
+        // The swap and the kept marker copy are the only work done under the lock; the old back
+        // buffer is published while the control thread fills the other one
+        int front;
+        {
+            std::lock_guard<std::mutex> lock(sceneMutex);
+            front = backScene;
+            backScene = 1 - backScene;
+            if(subscribers > 0 && (keptMarkersChanged || newSubscriber)){
+                scenes[front].markers.markers = keptMarkers;
+                keptMarkersChanged = false;
+            }
+        }
+        publishScene(scenes[front]);
+        rate.sleep();
+    }
+}
+
+#pragma endregion
+
+void startVisualization(ros::NodeHandle &nh){
+    if(sceneRunning) return;
+    marker_pub = nh.advertise<visualization_msgs::MarkerArray>("visualization_marker_array", 10);
+    candidate_pub = nh.advertise<sensor_msgs::PointCloud2>("debug_candidates", 1);
+    frontier_pub = nh.advertise<sensor_msgs::PointCloud2>("debug_frontiers", 1);
+
+    sceneRunning = true;
+    sceneThread = std::thread(visualizationLoop);
+}
+
+void stopVisualization(){
+    sceneRunning = false;
+    if(sceneThread.joinable()) sceneThread.join();
+}
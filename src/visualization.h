@@ -0,0 +1,56 @@
+#ifndef visualizationHeader
+#define visualizationHeader
+
+#include "common.h"
+#include "pointGrid.h"
+#include <nav_msgs/OccupancyGrid.h>
+#include <visualization_msgs/Marker.h>
+#include <visualization_msgs/MarkerArray.h>
+
+// Debug view of the planning internals. The control thread writes candidates, target, visited
+// cells, frontiers and planned paths into a back buffer; a publisher thread swaps buffers at
+// markerPublishRate and sends the front one as a MarkerArray plus PointCloud2 clouds, so the
+// control loop never serializes anything. While nothing subscribes those setters return straight
+// away. One-off markers are kept regardless and resent to every new subscriber.
+
+enum SceneLayer { SCENE_CANDIDATES, SCENE_TARGET, SCENE_VISITED, SCENE_FRONTIERS, SCENE_PATH, SCENE_MARKERS, SCENE_LAYERS };
+
+struct DebugScene{
+    std::vector<std::array<float, 2>> candidates;   // odom frame
+    std::vector<std::array<float, 2>> visited;      // odom frame
+    std::vector<std::array<float, 2>> frontiers;    // map frame
+    std::vector<std::array<float, 2>> path;         // odom frame
+    std::array<float, 2> target;
+    visualization_msgs::MarkerArray markers;       // Kept markers to resend, then the layers
+    bool dirty[SCENE_LAYERS];
+};
+
+extern ros::Publisher marker_pub;   // visualization_msgs::MarkerArray
+
+extern float markerPublishRate;
+
+void startVisualization(ros::NodeHandle &nh);
+
+void stopVisualization();
+
+// True while someone subscribes to the debug topics
+bool sceneWanted();
+
+void setSceneCandidates(const PointGrid &candidates);
+
+void setSceneTarget(float x, float y);
+
+void setSceneVisited(const PointGrid &visited);
+
+// Free cells bordering unknown space in the latest map
+void setSceneFrontiers(const nav_msgs::OccupancyGrid &map);
+
+void setScenePath(const std::vector<std::array<float, 2>> &path);
+
+// Planned constant-curvature arc from the current pose
+void setScenePathArc(float posX, float posY, float yawDeg, float linear, float angular, float horizon);
+
+// Kept until markerQueueLimit newer ones push it out, replacing any with the same namespace and id
+void queueMarker(const visualization_msgs::Marker &marker);
+
+#endif
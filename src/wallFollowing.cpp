@@ -134,7 +134,7 @@ std::vector<std::pair<double, double>> get_all_corners() {
     return all_corners;
 }
 
-void moveRobot(double linear_x, double angular_z, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub) {
+void moveRobot(double linear_x, double angular_z, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub, const CancelToken &cancel){
     // 设定固定速度 0.1 m/s
     double speed = 0.1;  
     double duration = linear_x / speed; // 计算所需时间
@@ -143,24 +143,24 @@ void moveRobot(double linear_x, double angular_z, geometry_msgs::Twist &vel_msg,
     vel_msg.linear.x = speed;
     vel_msg.angular.z = angular_z;
 
-    ros::Time start_time = ros::Time::now();
-    while ((ros::Time::now() - start_time).toSec() < duration) {
-        vel_pub.publish(vel_msg); // 发布速度指令
-        ros::spinOnce(); // 处理ROS回调
-        ros::Duration(0.1).sleep(); // 控制循环频率
+    double start_time = clockNow();
+    while (clockNow() - start_time < duration && !cancel.requested()) {
+        publishVelocity(vel_msg, vel_pub); // 发布速度指令
+        spinSensors(); // 处理ROS回调
+        clockSleep(0.1); // 控制循环频率
     }
 
     // 停止机器人
     vel_msg.linear.x = 0;
     vel_msg.angular.z = 0;
-    vel_pub.publish(vel_msg);
+    stopVelocity(vel_pub);
 
     ROS_INFO("Robot moved %.2f meters at 0.1 m/s", linear_x);
 }
 
 
 // Function to rotate the robot locally
-void rotateRobot(double angular_speed, double duration, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub) {
+void rotateRobot(double angular_speed, double duration, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub, const CancelToken &cancel){
 
     // Set linear velocity to 0 (no forward/backward movement)
     vel_msg.linear.x = 0.0;
@@ -172,112 +172,46 @@ void rotateRobot(double angular_speed, double duration, geometry_msgs::Twist &ve
     vel_msg.angular.y = 0.0;
     vel_msg.angular.z = angular_speed; // Positive for counterclockwise, negative for clockwise
 
-    ros::Time start_time = ros::Time::now();
-    while ((ros::Time::now() - start_time).toSec() < duration) {
-        vel_pub.publish(vel_msg); // Publish the velocity command
-        ros::spinOnce(); // Allow ROS to process callbacks
-        ros::Duration(0.1).sleep(); // Sleep for a short time to control the loop rate
+    double start_time = clockNow();
+    while (clockNow() - start_time < duration && !cancel.requested()) {
+        publishVelocity(vel_msg, vel_pub); // Publish the velocity command
+        spinSensors(); // Allow ROS to process callbacks
+        clockSleep(0.1); // Sleep for a short time to control the loop rate
     }
 
     // Stop the robot after the duration
     vel_msg.angular.z = 0.0; // Stop rotation
-    vel_pub.publish(vel_msg);
+    stopVelocity(vel_pub);
     ROS_INFO("Rotation complete. Robot stopped.");
 }
 
-void wallFollowing(WallSide wall_side, DistancesStruct distances, bool curr_turn, bool prev_turn, float left_dist, float right_dist, float front_dist, float target_distance, float min_speed, float k, float alpha, geometry_msgs::Twist &vel, ros::Publisher &vel_pub) {
-    float safe_threshold = 0.5;
-
-    float max_speed = 0.25;
-
-    // Update linear speed based on wall distances
-    if (distances.min >= safe_threshold) {
-        vel.linear.x = max_speed;
-    }
-    else {
-        vel.linear.x = min_speed + (max_speed - min_speed) * ((distances.min - target_distance) / (safe_threshold - target_distance));
-        vel.linear.x = std::max(static_cast<double>(min_speed), std::min(static_cast<double>(max_speed), vel.linear.x));
-    }
-    
-    bumper_handling(vel, vel_pub);
-    // **Wall-Following Logic**
-    if (front_dist > 0.9) {
-        if (wall_side == LEFT) {
-            // Follow the left wall
-            if (left_dist < target_distance) {
-                vel.angular.z = -k * (1 - exp(-alpha * left_dist)); // Adjust right
-            } else if (left_dist > target_distance) {
-                
-                vel.angular.z = Deg2Rad(28);  // Adjust left
-            } else {
-                vel.angular.z = 0.0;  // No adjustment needed
-            }
-        } else if (wall_side == RIGHT) {
-            // Follow the right wall
-            if (right_dist < target_distance) {
-                vel.angular.z = k * (1 - exp(-alpha * right_dist)); // Adjust left
-            } else if (right_dist > target_distance) {
-                vel.angular.z = -k * (1 - exp(-alpha * right_dist)); // Adjust right
-            } else {
-                vel.angular.z = 0.0;  // No adjustment needed
-            }
-        }
-    } 
-
-    else if (front_dist < 0.68 & left_dist < 0.6 & right_dist < 0.68 ) {
-        // vel.angular.z = -1.57;  // 1.57 radians = 90 degrees
-        ROS_INFO("surrounded by three walls");
-        rotateRobot(-0.25, 12.56, vel, vel_pub);
-        rotateRobot(0, 0, vel, vel_pub);
-        curr_turn = true;
-        
-    }
-    else if (front_dist < 0.9 & left_dist < 0.9 & right_dist > 0.9  & curr_turn != prev_turn) {
-        // vel.angular.z = -1.57;  // 1.57 radians = 90 degrees
-        ROS_INFO("Turn to the right");
-        rotateRobot(-0.18, 6.28, vel, vel_pub);
-        rotateRobot(0, 0, vel, vel_pub);
-        curr_turn = true;
-    }
-    else if (front_dist < 0.9 & left_dist > 0.9 & right_dist < 0.9 & curr_turn != prev_turn) {
-        // vel.angular.z = -1.57;  // 1.57 radians = 90 degrees
-        ROS_INFO("Turn to the left");
-        rotateRobot(0.18, 6.28, vel, vel_pub);
-        rotateRobot(0, 0, vel, vel_pub);
-        curr_turn = true;
-    }
-    else {
-        // Obstacle detected in front, slow down and turn
-        vel.linear.x = min_speed; // Slow down
-        vel.angular.z = (wall_side == LEFT) ? -0.26 : 0.26; // Turn away from the wall
-    }
-}
-
-void bumper_handling (geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+void bumper_handling (geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
     if(bumpers.anyPressed){
         if(bumpers.leftPressed){
-            handleBumperPressed2((float) -45.0, vel, vel_pub);
+            handleBumperPressed2((float) -45.0, vel, vel_pub, cancel);
         }
 
         else if(bumpers.rightPressed){
-            handleBumperPressed2((float) 45.0, vel, vel_pub);
+            handleBumperPressed2((float) 45.0, vel, vel_pub, cancel);
         }
 
         else if(bumpers.centerPressed){
-            handleBumperPressed2((float) 0.0, vel, vel_pub);
+            handleBumperPressed2((float) 0.0, vel, vel_pub, cancel);
         }
         }
 }
 
-void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
-    ROS_INFO("handleBumperPressed2() called...");
+void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel){
+    BehaviorScope behavior(BEHAVIOR_BUMPER_RECOVERY);
+    logEvent(EV_BUMPER_RECOVERY_START, turnAngle);
+    resetVelocityProfiler();   // The bumper hit has already stopped the base
     float reverseDistance = 0.2;
     float forwardDistance = reverseDistance / std::cos(Deg2Rad(turnAngle)) * 0.9;
 
     float exitDistanceThreshold = 0.02;
 
     // 1. Reverse
-    ROS_INFO("handleBumperPressed2() | Reversing...");
+    logEvent(EV_BUMPER_REVERSING, posX, posY);
     float x0 = posX;
     float y0 = posY;
     
@@ -285,8 +219,8 @@ void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publi
     float dy;
     float d = 0;
 
-    while((d-reverseDistance) < exitDistanceThreshold){
-        ros::spinOnce();
+    while((d-reverseDistance) < exitDistanceThreshold && !cancel.requested()){
+        spinSensors();
 
         linear = -0.1;
         angular = 0;
@@ -299,13 +233,17 @@ void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publi
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
     }
 
 
     // 2. Turn
     if(turnAngle == 0){ // If center bumper was pressed this is called
-        if(distances.leftRay > distances.rightRay){
+        // Turn towards the side with more room, remembered obstacles included since the fan
+        // cannot see beside the robot
+        float leftRoom = std::min(distances.leftRay, nearestObstacleInArc(20, 120));
+        float rightRoom = std::min(distances.rightRay, nearestObstacleInArc(-120, -20));
+        if(leftRoom > rightRoom){
             turnAngle = 45;
         }
 
@@ -314,19 +252,20 @@ void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publi
         }
 
     }
-    ROS_INFO("handleBumperPressed2() | Turning...");
-    rotateToHeading(yaw + turnAngle, vel, vel_pub);
+    logEvent(EV_BUMPER_TURNING, turnAngle, yaw);
+    rotateToHeading(yaw + turnAngle, vel, vel_pub, cancel);
 
     // 3. Drive Forward
-    ROS_INFO("handleBumperPressed2() | Advancing...");
+    logEvent(EV_BUMPER_ADVANCING, forwardDistance);
     x0 = posX;
     y0 = posY;
     dx = 0;
     dy = 0;
     d = 0;
-    ROS_INFO("%.2f", d-forwardDistance);
-    while((d-forwardDistance) < exitDistanceThreshold){
-        ros::spinOnce();
+    float progressD = 0;
+    double lastProgress = clockNow();
+    while((d-forwardDistance) < exitDistanceThreshold && !cancel.requested()){
+        spinSensors();
 
         linear = 0.1;
         angular = 0;
@@ -335,28 +274,293 @@ void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publi
         dy = posY-y0;
         d = (float) sqrt(pow(dx, 2) + pow(dy, 2));
 
-
+        // Same stall exit as handleBumperPressed()
+        if(d > progressD + recoveryStallDistance){
+            progressD = d;
+            lastProgress = clockNow();
+        }
+        else if(clockNow() - lastProgress > recoveryStallTimeout){
+            ROS_INFO("handleBumperPressed2() | Advance blocked after %.2f m, moving on", d);
+            break;
+        }
 
         vel.angular.z = angular;
         vel.linear.x = linear;
-        vel_pub.publish(vel);
+        publishVelocity(vel, vel_pub);
     }
 
     // 4. Turn Back
-    ROS_INFO("handleBumperPressed2() | Correcting yaw...");
-    rotateToHeading(yaw - turnAngle * 0.7, vel, vel_pub);
+    logEvent(EV_BUMPER_CORRECTING, yaw);
+    rotateToHeading(yaw - turnAngle * 0.7, vel, vel_pub, cancel);
 
 
 
-    ROS_INFO("handleBumperPressed2() | END");
     linear = 0;
     angular = 0;
 
     vel.angular.z = angular;
     vel.linear.x = linear;
-    vel_pub.publish(vel);
+    stopVelocity(vel_pub);
+    logEvent(EV_BUMPER_RECOVERY_END, yaw);
 
     return;
 
 }
 
+
+#pragma region Fitted wall following
+
+float wallSectorInnerAngle = 8.0;   // Degrees from the centre ray where the side sector starts
+float wallMaxRange = 3.0;           // Ignore returns beyond this when fitting (m)
+float wallInlierTolerance = 0.05;   // Same deviation limit isWallSegment() uses (m)
+int minWallInliers = 12;
+
+float kp_wd = 1.2;      // Distance error gain (rad/s per m)
+float kd_wd = 0.4;      // Distance error rate gain
+float kp_wa = 1.5;      // Wall angle gain (rad/s per rad)
+float kd_wa = 0.1;      // Wall angle rate gain
+
+float wallFrontTurnDistance = 0.9;  // Below this the wall ahead takes over from the PD law
+float wallFrontSlowDistance = 1.8;  // Above this the robot runs at maxLinear
+
+float wallEndClearance = 0.15;          // Side clearance needed before arcing round a wall end (m)
+float frontSectorHalfAngle = 12.0;      // Degrees either side of the centre ray used for the wall ahead
+float cornerTurnMaxCorrection = 30.0;   // Largest difference from the nominal turn the scan may apply (degrees)
+
+template<WallSide side> float sideRay(const DistancesStruct &d);
+template<> float sideRay<LEFT>(const DistancesStruct &d){ return d.leftRay; }
+template<> float sideRay<RIGHT>(const DistancesStruct &d){ return d.rightRay; }
+
+template<WallSide side> struct OppositeSide;
+template<> struct OppositeSide<LEFT>{ static const WallSide value = RIGHT; };
+template<> struct OppositeSide<RIGHT>{ static const WallSide value = LEFT; };
+
+// Total least squares fit over the points flagged in use. Returns the centroid and unit direction.
+static int fitLineTLS(const std::vector<std::array<float, 2>> &points, const std::vector<uint8_t> &use, float &cx, float &cy, float &dirX, float &dirY){
+    int count = 0;
+    double sx = 0, sy = 0;
+    for(size_t i = 0; i < points.size(); i++){
+        if(!use[i]) continue;
+        sx += points[i][0];
+        sy += points[i][1];
+        count++;
+    }
+    if(count < 2) return count;
+
+    cx = sx / count;
+    cy = sy / count;
+
+    double sxx = 0, syy = 0, sxy = 0;
+    for(size_t i = 0; i < points.size(); i++){
+        if(!use[i]) continue;
+        double dx = points[i][0] - cx;
+        double dy = points[i][1] - cy;
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+
+    double phi = 0.5 * std::atan2(2 * sxy, sxx - syy);
+    dirX = std::cos(phi);
+    dirY = std::sin(phi);
+    return count;
+}
+
+// Robust line fit over the rays with bearings in [minAngle, maxAngle] (rad). On success the
+// wall distance and angle are filled in and offset holds the signed distance of the line from
+// the robot, positive when it passes on the left.
+static bool fitSectorLine(const ScanStruct &scan, float minAngle, float maxAngle, float &offset, WallEstimate &wall){
+    static std::vector<std::array<float, 2>> points;
+    static std::vector<uint8_t> use;
+
+    wall.valid = false;
+    wall.inliers = 0;
+    points.clear();
+
+    // 1. Collect the sector in the robot frame (x forward, y left)
+    float maxRange = std::min(wallMaxRange, scan.rangeMax);
+    for(size_t i = 0; i < scan.ranges.size(); i++){
+        float angle = scan.angleMin + i * scan.angleIncrement;
+        float range = scan.ranges[i];
+        if(angle < minAngle || angle > maxAngle) continue;
+        if(!std::isfinite(range) || range < scan.rangeMin || range > maxRange) continue;
+
+        points.push_back({range * std::cos(angle), range * std::sin(angle)});
+    }
+    if((int) points.size() < minWallInliers) return false;
+
+    // 2. Fit, then refit twice on the points close to the previous line so a corner or an
+    //    obstacle inside the sector does not drag the estimate
+    use.assign(points.size(), 1);
+    float cx = 0, cy = 0, dirX = 1, dirY = 0;
+    const float gates[2] = {3 * wallInlierTolerance, wallInlierTolerance};
+    int count = fitLineTLS(points, use, cx, cy, dirX, dirY);
+
+    for(int pass = 0; pass < 2 && count >= minWallInliers; pass++){
+        for(size_t i = 0; i < points.size(); i++){
+            float residual = std::abs(-(points[i][0] - cx) * dirY + (points[i][1] - cy) * dirX);
+            use[i] = residual < gates[pass];
+        }
+        count = fitLineTLS(points, use, cx, cy, dirX, dirY);
+    }
+    if(count < minWallInliers) return false;
+
+    // 3. Point the direction forward so the angle lands in (-90, 90] degrees
+    if(dirX < 0 || (dirX == 0 && dirY < 0)){
+        dirX = -dirX;
+        dirY = -dirY;
+    }
+
+    offset = -cx * dirY + cy * dirX;
+
+    wall.valid = true;
+    wall.distance = std::abs(offset);
+    wall.angle = std::atan2(dirY, dirX);
+    wall.inliers = count;
+    return true;
+}
+
+template<WallSide side> bool fitWallLine(const ScanStruct &scan, WallEstimate &wall){
+    float innerAngle = Deg2Rad(wallSectorInnerAngle);
+    float minAngle = side == LEFT ? innerAngle : -M_PI;
+    float maxAngle = side == LEFT ? M_PI : -innerAngle;
+    float offset;
+
+    if(!fitSectorLine(scan, minAngle, maxAngle, offset, wall)) return false;
+
+    // Reject a line that passes on the wrong side, e.g. a wall ahead seen only by the sector edge
+    if(wallSign<side>() * offset <= 0){
+        wall.valid = false;
+        return false;
+    }
+    return true;
+}
+
+bool fitFrontWall(const ScanStruct &scan, WallEstimate &wall){
+    float halfAngle = Deg2Rad(frontSectorHalfAngle);
+    float offset;
+    return fitSectorLine(scan, -halfAngle, halfAngle, offset, wall);
+}
+
+float cornerTurnAngle(float nominalDeg){
+    // Turn until parallel to the wall ahead. Of the two parallel headings take the one in the
+    // nominal turn direction, and fall back to the nominal angle if the fit disagrees badly.
+    WallEstimate front;
+    if(!fitFrontWall(scan, front)){
+        return nominalDeg;
+    }
+
+    float delta = Rad2Deg(front.angle);
+    if(delta * nominalDeg < 0){
+        delta += nominalDeg < 0 ? -180 : 180;
+    }
+
+    if(std::abs(delta - nominalDeg) > cornerTurnMaxCorrection){
+        return nominalDeg;
+    }
+    return delta;
+}
+
+template<WallSide side> void wallFollowingPD(WallFollowState &state, float target_distance, float min_speed, geometry_msgs::Twist &vel, ros::Publisher &vel_pub){
+    const float sign = wallSign<side>();
+    const float maxRate = Deg2Rad(maxAngular);
+
+    float front_dist = std::isnan(distances.frontRay) ? wallFrontSlowDistance : distances.frontRay;
+    float wall_dist = sideRay<side>(distances);
+    float away_dist = sideRay<OppositeSide<side>::value>(distances);
+
+    bumper_handling(vel, vel_pub);
+
+    bool haveWall = fitWallLine<side>(scan, state.wall);
+    double now = clockNow();
+    state.currTurn = false;
+
+    // Governed top speed while the way ahead is clear, blending down to min_speed as the front closes in
+    float topSpeed = std::max(min_speed, governedSpeedLimit(maxLinear, vel.angular.z));
+    float frontScale = (front_dist - wallFrontTurnDistance) / (wallFrontSlowDistance - wallFrontTurnDistance);
+    frontScale = std::max(0.0f, std::min(1.0f, frontScale));
+    float speed = min_speed + (topSpeed - min_speed) * frontScale;
+
+    if(front_dist > wallFrontTurnDistance && haveWall){
+        // PD on distance error and wall angle. A positive angle means the wall runs
+        // counterclockwise of the heading, so turning by it brings the robot parallel.
+        float distanceError = state.wall.distance - target_distance;
+        float dDistance = 0;
+        float dAngle = 0;
+
+        if(state.havePrev){
+            float dt = now - state.prevTime;
+            if(dt > 1e-3){
+                dDistance = (distanceError - state.prevDistanceError) / dt;
+                dAngle = (state.wall.angle - state.prevAngle) / dt;
+            }
+        }
+
+        float angularCmd = sign * (kp_wd * distanceError + kd_wd * dDistance) + kp_wa * state.wall.angle + kd_wa * dAngle;
+        angularCmd = std::max(-maxRate, std::min(maxRate, angularCmd));
+
+        // Give up some speed while correcting hard so the wall stays inside the fan
+        speed *= 1 - 0.5 * std::abs(angularCmd) / maxRate;
+
+        vel.linear.x = std::max(speed, min_speed);
+        vel.angular.z = angularCmd;
+
+        state.prevDistanceError = distanceError;
+        state.prevAngle = state.wall.angle;
+        state.prevTime = now;
+        state.havePrev = true;
+    }
+
+    else if(front_dist > wallFrontTurnDistance){
+        // Wall ended or left the sector: arc towards the wall side to pick it back up, unless
+        // the memory of what the fan saw earlier says the wall end is right beside the robot
+        state.havePrev = false;
+        vel.linear.x = min_speed;
+        vel.angular.z = sign * Deg2Rad(28);
+        if(nearestObstacleInArc(side == LEFT ? 30 : -90, side == LEFT ? 90 : -30) < robotRadius + wallEndClearance){
+            vel.angular.z = 0;
+        }
+    }
+
+    else if(front_dist < 0.68 && wall_dist < 0.6 && away_dist < 0.68){
+        ROS_INFO("surrounded by three walls");
+        state.havePrev = false;
+
+        // Turn around to run antiparallel to the side wall, measured rather than timed
+        float uTurn = -sign * 180;
+        if(haveWall){
+            uTurn += Rad2Deg(state.wall.angle);
+        }
+        turnByAngle(uTurn, vel, vel_pub);
+        state.currTurn = true;
+    }
+
+    else if(wall_dist < target_distance && away_dist > target_distance && !state.prevTurn){
+        ROS_INFO("Inside corner, turning away from the wall");
+        state.havePrev = false;
+        turnByAngle(cornerTurnAngle(-sign * 90), vel, vel_pub);
+        state.currTurn = true;
+    }
+
+    else if(wall_dist > target_distance && away_dist < target_distance && !state.prevTurn){
+        ROS_INFO("Opening on the wall side, turning towards it");
+        state.havePrev = false;
+        turnByAngle(cornerTurnAngle(sign * 90), vel, vel_pub);
+        state.currTurn = true;
+    }
+
+    else {
+        // Obstacle detected in front, slow down and turn away from the wall
+        vel.linear.x = min_speed;
+        vel.angular.z = -sign * 0.26;
+    }
+
+    state.prevTurn = state.currTurn;
+}
+
+template bool fitWallLine<LEFT>(const ScanStruct &scan, WallEstimate &wall);
+template bool fitWallLine<RIGHT>(const ScanStruct &scan, WallEstimate &wall);
+template void wallFollowingPD<LEFT>(WallFollowState &state, float target_distance, float min_speed, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+template void wallFollowingPD<RIGHT>(WallFollowState &state, float target_distance, float min_speed, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+
+#pragma endregion
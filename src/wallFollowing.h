@@ -2,11 +2,34 @@
 #define wallFollowingHeader
 
 #include "common.h"
+#include "cancelToken.h"
 #include "bumper.h"
 #include "movement.h"
+#include "speedGovernor.h"
 
 enum WallSide { LEFT, RIGHT };
 
+// +1 for a wall on the left, -1 for a wall on the right. Resolved at compile time so the
+// templated controller below has no runtime side branches.
+template<WallSide side> constexpr float wallSign(){ return side == LEFT ? 1.0f : -1.0f; }
+
+struct WallEstimate{
+    bool valid;
+    float distance;     // Perpendicular distance from the robot to the fitted wall line (m)
+    float angle;        // Wall direction relative to the robot heading (rad), + is counterclockwise
+    int inliers;
+};
+
+struct WallFollowState{
+    WallEstimate wall;
+    float prevDistanceError;
+    float prevAngle;
+    double prevTime;
+    bool havePrev;
+    bool currTurn;
+    bool prevTurn;
+};
+
 
 void get_coord();
 
@@ -24,15 +47,21 @@ int line_side(const std::pair<double, double>& point, const std::pair<double, do
 
 std::vector<std::pair<double, double>> get_all_corners();
 
-void moveRobot(double linear_x, double angular_z, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub);
+void moveRobot(double linear_x, double angular_z, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+
+void rotateRobot(double angular_speed, double duration, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+
+void bumper_handling (geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
+
+void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub, const CancelToken &cancel = motionCancel);
 
-void rotateRobot(double angular_speed, double duration, geometry_msgs::Twist &vel_msg, ros::Publisher &vel_pub);
+template<WallSide side> bool fitWallLine(const ScanStruct &scan, WallEstimate &wall);
 
-void wallFollowing(WallSide wall_side, DistancesStruct distances, bool curr_turn, bool prev_turn, float left_dist, float right_dist, float front_dist, float target_distance, float min_speed, float k, float alpha, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+bool fitFrontWall(const ScanStruct &scan, WallEstimate &wall);
 
-void bumper_handling (geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+float cornerTurnAngle(float nominalDeg);
 
-void handleBumperPressed2(float turnAngle, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
+template<WallSide side> void wallFollowingPD(WallFollowState &state, float target_distance, float min_speed, geometry_msgs::Twist &vel, ros::Publisher &vel_pub);
 
 
 
@@ -0,0 +1,97 @@
+#include "watchdog.h"
+#include "sensorMailbox.h"
+#include "eventLog.h"
+#include "commandArbiter.h"
+#include "clock.h"
+
+#include <atomic>
+
+double watchdogScanPeriod = 1.0 / 30;   // Expected Kinect scan period (s)
+double watchdogRateWindow = 1.0;        // s over which the arrival rate is measured
+
+// Ages and counts are stamped on the sensor spinner thread, so they follow the topics rather
+// than the control loop. Two scan periods tolerate one late or dropped scan.
+WatchdogBudget watchdogBudgets[] = {
+    {"scan", 2 * watchdogScanPeriod, 10},
+    {"odom", 2 * watchdogScanPeriod, 20},
+};
+const int watchdogTopics = sizeof(watchdogBudgets) / sizeof(watchdogBudgets[0]);
+
+static std::thread watchdogThread;
+static std::atomic<bool> watchdogRunning{false};
+static std::atomic<bool> watchdogStop{false};
+
+static double topicAge(int topic){
+    return topic == 0 ? scanMailbox.age() : odomMailbox.age();
+}
+
+static uint64_t topicCount(int topic){
+    return topic == 0 ? scanMailbox.received.load(std::memory_order_relaxed) : odomMailbox.received.load(std::memory_order_relaxed);
+}
+
+static void watchdogLoop(){
+    double period = 0.5 * watchdogScanPeriod;
+    int windowTicks = std::max(1, (int) std::lround(watchdogRateWindow / (0.5 * watchdogScanPeriod)));
+
+    std::vector<uint64_t> windowStart(watchdogTopics, 0);
+    std::vector<double> rate(watchdogTopics, std::numeric_limits<double>::infinity());
+    int tick = 0;
+
+    while(watchdogRunning && ros::ok()){
+        // 1. Arrival rate over the last window; the age check covers the time until the first one
+        if(tick % windowTicks == 0){
+            for(int t = 0; t < watchdogTopics; t++){
+                uint64_t count = topicCount(t);
+                if(tick > 0) rate[t] = (count - windowStart[t]) / watchdogRateWindow;
+                windowStart[t] = count;
+            }
+        }
+        tick++;
+
+        // 2. Budgets
+        int breached = -1;
+        for(int t = 0; t < watchdogTopics && breached < 0; t++){
+            if(topicAge(t) > watchdogBudgets[t].maxAge || rate[t] < watchdogBudgets[t].minRate){
+                breached = t;
+            }
+        }
+
+        if(breached >= 0 && !watchdogStop){
+            watchdogStop = true;
+            logEvent(EV_WATCHDOG_BREACH, breached, topicAge(breached), rate[breached]);
+            ROS_WARN("watchdogLoop() | %s out of budget (age %.2f s, %.1f Hz), stopping.", watchdogBudgets[breached].topic,
+                topicAge(breached), rate[breached]);
+        }
+        else if(breached < 0 && watchdogStop){
+            watchdogStop = false;
+            cancelCommand(SOURCE_SAFETY_STOP);
+            logEvent(EV_WATCHDOG_RESUME);
+            ROS_WARN("watchdogLoop() | Sensors back within budget, resuming.");
+        }
+
+        // 3. Hold the robot while stopped, preempting every controller. The request outlives
+        //    two watchdog periods, so it lapses by itself if this thread ever stops.
+        if(watchdogStop){
+            geometry_msgs::Twist stop;
+            submitCommand(SOURCE_SAFETY_STOP, stop, watchdogScanPeriod, {0, 0, BEHAVIOR_OTHER});
+        }
+
+        clockSleep(period);
+    }
+}
+
+void startWatchdog(){
+    if(watchdogRunning) return;
+    watchdogRunning = true;
+    watchdogThread = std::thread(watchdogLoop);
+}
+
+void stopWatchdog(){
+    watchdogRunning = false;
+    if(watchdogThread.joinable()) watchdogThread.join();
+    watchdogStop = false;
+}
+
+bool watchdogStopped(){
+    return watchdogStop.load(std::memory_order_relaxed);
+}
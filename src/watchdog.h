@@ -0,0 +1,25 @@
+#ifndef watchdogHeader
+#define watchdogHeader
+
+#include "common.h"
+
+// Sensor-staleness watchdog. A background thread checks the age and arrival rate of each
+// watched stream against its budget every half scan period. On a breach it submits zero twists
+// at safety-stop priority from its own thread, so the arbiter stops the robot at its next period
+// even while the control thread is stuck. When every stream is back within budget the requests
+// lapse and the controllers resume on their own.
+
+struct WatchdogBudget{
+    const char *topic;
+    double maxAge;      // s since the newest sample
+    double minRate;     // Hz over the last watchdogRateWindow
+};
+
+void startWatchdog();
+
+void stopWatchdog();
+
+// True while a stream is out of budget and the robot is held stopped
+bool watchdogStopped();
+
+#endif